@@ -3,44 +3,131 @@
 using namespace viewer;
 
 void Facade::LoadScene(string path, NormalizationParameters params) {
-  Scene scene = fileReader_->ReadScene(path, params);
-  *scene_ = scene;
+  auto scene =
+      std::make_shared<Scene>(ReaderFor(path)->ReadScene(path, params));
+  if (quantize_) scene->Quantize();
+  // кластеры переставляют вершины, поэтому строятся до уровней
+  // детализации и ломаных
+  scene->BuildClusters();
+  scene->BuildLods();
+  if (strips_) scene->BuildStrips();
+  FinishLoading(std::move(scene), path);
+}
+
+void Facade::FinishLoading(shared_ptr<Scene> scene, const string &path) {
+  scene_ = std::move(scene);
   SceneInfo info;
   info.vertex_count = 0;
   info.edge_count = 0;
 
-  for (auto &figure : scene.GetFigures()) {
-    info.vertex_count += figure->GetVertices().size();
-    info.edge_count += figure->GetEdges().size();
+  for (auto &figure : scene_->GetFigures()) {
+    info.vertex_count += figure->GetVertexCount();
+    info.edge_count += figure->GetEdgeCount();
   }
+  info.memory = scene_->GetMemoryUsage();
+  info.quantization_error = scene_->GetQuantizationError();
   info.file_name = path;
 
   emit sceneLoaded(info);  // создает сигнал о том, что сцена загружена
 }
 
+void Facade::LoadSceneAsync(string path, NormalizationParameters params) {
+  if (IsLoading()) {
+    // новая загрузка начнётся, когда текущая вернёт управление
+    CancelLoading();
+    hasPending_ = true;
+    pendingPath_ = path;
+    pendingParams_ = params;
+    return;
+  }
+  StartLoading(path, params);
+}
+
+BaseFileReader *Facade::ReaderFor(const string &path) const {
+  switch (DetectFileFormat(path)) {
+    case FileFormat::kObjStream:
+      return streamReader_;
+    case FileFormat::kStl:
+      return stlReader_;
+    case FileFormat::kPly:
+      return plyReader_;
+    default:
+      return fileReader_;
+  }
+}
+
+void Facade::StartLoading(string path, NormalizationParameters params) {
+  BaseFileReader *reader = ReaderFor(path);
+  cancel_ = std::make_shared<atomic<bool>>(false);
+  reader->setCancellationToken(cancel_);
+  reader->setProgressCallback([this](const LoadProgress &progress) {
+    emit loadProgress(progress.bytes_read, progress.total_bytes,
+                      progress.records_parsed);
+  });
+  if (streaming_) {
+    reader->setBatchCallback([this](shared_ptr<GeometryBatch> batch) {
+      QMetaObject::invokeMethod(
+          this, [this, batch]() { emit geometryBatchLoaded(batch); },
+          Qt::QueuedConnection);
+    });
+  } else {
+    reader->setBatchCallback(nullptr);
+  }
+
+  auto cancel = cancel_;
+  bool quantize = quantize_;
+  bool strips = strips_;
+  worker_ = std::thread([this, reader, path, params, cancel, quantize,
+                         strips]() {
+    auto scene = std::make_shared<Scene>(reader->ReadScene(path, params));
+    if (quantize) scene->Quantize();
+    scene->BuildClusters();
+    scene->BuildLods();
+    if (strips) scene->BuildStrips();
+    QMetaObject::invokeMethod(
+        this,
+        [this, scene, path, cancel]() {
+          worker_.join();
+          if (cancel->load()) {
+            emit loadCancelled();
+          } else {
+            FinishLoading(scene, path);
+          }
+          if (hasPending_) {
+            hasPending_ = false;
+            StartLoading(pendingPath_, pendingParams_);
+          }
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void Facade::CancelLoading() {
+  if (cancel_) {
+    cancel_->store(true);
+  }
+}
+
 // слот обрабатывает сигнал loadSceneRequested от MainWindow
 void Facade::onLoadSceneRequested(const QString &path,
                                   NormalizationParameters params) {
-  LoadScene(path.toStdString(), params);
+  LoadSceneAsync(path.toStdString(), params);
 }
 
+bool Facade::ApplyPendingTransforms() { return scene_->Transform(); }
+
 void Facade::MoveScene(double x, double y, double z) {
   for (auto &figure : scene_->GetFigures()) {
     figure->setMove(x, y, z);
-    figure->Transform();
   }
 }
 void Facade::RotateScene(double x, double y, double z) {
   for (auto &figure : scene_->GetFigures()) {
     figure->setRotate(x, y, z);
-    figure->Transform();
   }
 }
 void Facade::ScaleScene(double x) {
   for (auto &figure : scene_->GetFigures()) {
     figure->setScale(x);
-    figure->Transform();
   }
 }
-
-Scene *Facade::getScene() { return scene_; }
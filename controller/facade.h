@@ -2,6 +2,7 @@
 #define SRC_3DVIEWER_CONTROLLER_FACADE_H_
 
 #include <QObject>
+#include <thread>
 
 #include "../model/model.h"
 
@@ -10,37 +11,102 @@ namespace viewer {
 class Facade : public QObject {
   Q_OBJECT
  public:
-  explicit Facade(Scene *scene, BaseFileReader *fileReader = nullptr)
-      : fileReader_(fileReader), scene_(scene) {
+  // Читатель выбирается DetectFileFormat: streamReader читает gzip и
+  // стандартный ввод ("-"), fileReader - остальные OBJ.
+  explicit Facade(BaseFileReader *fileReader = nullptr,
+                  BaseFileReader *streamReader = nullptr)
+      : fileReader_(fileReader),
+        streamReader_(streamReader),
+        stlReader_(new StlFileReader()),
+        plyReader_(new PlyFileReader()),
+        scene_(std::make_shared<Scene>()) {
     if (!fileReader_) {
-      fileReader_ = new FileReader();
+      fileReader_ = new MappedFileReader();
+    }
+    if (!streamReader_) {
+      streamReader_ = new StreamFileReader();
     }
   }
 
   ~Facade() {
+    CancelLoading();
+    if (worker_.joinable()) {
+      worker_.join();
+    }
     if (fileReader_) {
       delete fileReader_;
     }
+    if (streamReader_) {
+      delete streamReader_;
+    }
+    delete stlReader_;
+    delete plyReader_;
   }
-  Scene *getScene();
+  // Текущая сцена. Загрузка заменяет указатель, а не содержимое, поэтому
+  // сцена, переданная виду, не меняется под ним.
+  shared_ptr<Scene> getScene() const { return scene_; }
 
   // паттерн фасад
   void LoadScene(string path, NormalizationParameters params);
+  // Загрузка в рабочем потоке: текущая сцена остаётся доступной, пока
+  // новая не будет полностью прочитана.
+  void LoadSceneAsync(string path, NormalizationParameters params);
+  void CancelLoading();
+  bool IsLoading() const { return worker_.joinable(); }
+  // Потоковый режим: во время загрузки прочитанная геометрия публикуется
+  // частями сигналом geometryBatchLoaded.
+  void setStreamingEnabled(bool enabled) { streaming_ = enabled; }
+  bool isStreamingEnabled() const { return streaming_; }
+  // Компактный режим: после чтения позиции квантуются в 16 бит
+  // (Scene::Quantize), ошибка попадает в SceneInfo::quantization_error.
+  void setQuantizationEnabled(bool enabled) { quantize_ = enabled; }
+  bool isQuantizationEnabled() const { return quantize_; }
+  // После чтения рёбра сцепляются в ломаные (Scene::BuildStrips), что
+  // вдвое сокращает вывод вершин у QTSceneDrawer. VboSceneDrawer рисует
+  // пары номеров, так что с ним ломаные - лишняя память.
+  void setStripsEnabled(bool enabled) { strips_ = enabled; }
+  bool isStripsEnabled() const { return strips_; }
+  // Только запоминают параметры в фигурах и помечают их изменёнными;
+  // позиции пересчитываются в ApplyPendingTransforms, так что частые
+  // события ввода между кадрами стоят одного пересчёта.
   void MoveScene(double x, double y, double z);
   void RotateScene(double x, double y, double z);
   void ScaleScene(double x);
  signals:
   void sceneLoaded(const SceneInfo &info);
+  // испускается из рабочего потока загрузки
+  void loadProgress(qint64 bytesRead, qint64 totalBytes, qint64 recordsParsed);
+  void loadCancelled();
+  // испускается в потоке GUI, первая часть имеет first_vertex == 0
+  void geometryBatchLoaded(std::shared_ptr<const GeometryBatch> batch);
 
  public slots:
   void onLoadSceneRequested(const QString &path,
                             NormalizationParameters params);
+  // Вызывается перед отрисовкой кадра; false, если пересчитывать было
+  // нечего.
+  bool ApplyPendingTransforms();
 
  private:
+  BaseFileReader *ReaderFor(const string &path) const;
+  void StartLoading(string path, NormalizationParameters params);
+  void FinishLoading(shared_ptr<Scene> scene, const string &path);
+
   BaseFileReader *fileReader_;
-  Scene *scene_;
+  BaseFileReader *streamReader_;
+  BaseFileReader *stlReader_;
+  BaseFileReader *plyReader_;
+  shared_ptr<Scene> scene_;
+  std::thread worker_;
+  shared_ptr<atomic<bool>> cancel_;
+  bool streaming_ = false;
+  bool quantize_ = false;
+  bool strips_ = false;
+  bool hasPending_ = false;
+  string pendingPath_;
+  NormalizationParameters pendingParams_;
 };
 
 }  // namespace viewer
 
-#endif  // SRC_3DVIEWER_CONTROLLER_FACADE_H_
\ No newline at end of file
+#endif  // SRC_3DVIEWER_CONTROLLER_FACADE_H_
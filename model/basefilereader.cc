@@ -0,0 +1,44 @@
+#include "model.h"
+using namespace viewer;
+
+bool BaseFileReader::IsBatchDue(bool force) const {
+  if (!batch_) return false;
+  return force ||
+         std::chrono::steady_clock::now() - lastBatch_ >= batchInterval_;
+}
+
+void BaseFileReader::SendBatch(shared_ptr<GeometryBatch> batch) {
+  lastBatch_ = std::chrono::steady_clock::now();
+  batch_(std::move(batch));
+}
+
+void BaseFileReader::PublishBatch(SceneBuilder &builder, bool force) {
+  if (!IsBatchDue(force)) return;
+  auto batch = make_shared<GeometryBatch>();
+  if (builder.TakeBatch(*batch)) SendBatch(std::move(batch));
+}
+
+Scene BaseFileReader::MakeScene(vector<float> positions, EdgeArray edges) {
+  Scene scene;
+  if (positions.empty()) return scene;
+  float min[3], max[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    min[axis] = std::numeric_limits<float>::max();
+    max[axis] = std::numeric_limits<float>::lowest();
+  }
+  for (size_t i = 0; i < positions.size(); ++i) {
+    min[i % 3] = std::min(min[i % 3], positions[i]);
+    max[i % 3] = std::max(max[i % 3], positions[i]);
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    double centre = min[axis] + (max[axis] - min[axis]) / 2;
+    for (size_t i = axis; i < positions.size(); i += 3) {
+      positions[i] -= centre;
+    }
+  }
+  auto figure = std::make_shared<Figure>();
+  std::visit([&](auto &array) { figure->setEdges(std::move(array)); }, edges);
+  figure->setPositions(std::move(positions));
+  scene.setFigures(figure);
+  return scene;
+}
@@ -0,0 +1,244 @@
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "model.h"
+using namespace viewer;
+
+namespace {
+constexpr char kMagic[8] = {'3', 'D', 'V', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t source_hash;
+  uint64_t figure_count;
+};
+
+// За заголовком для каждой фигуры идут счётчики, затем vertex_count
+// троек float и edge_count пар номеров по index_size байт - массив
+// рёбер фигуры как есть.
+struct FigureHeader {
+  uint64_t vertex_count;
+  uint64_t edge_count;
+  uint64_t index_size;
+};
+
+static_assert(sizeof(Edge16) == 4 && sizeof(Edge) == 8 &&
+              sizeof(Edge64) == 16);
+
+template <typename Index>
+bool ReadEdges(const char *data, size_t count, size_t vertex_count,
+               Figure &figure) {
+  vector<BasicEdge<Index>> edges(count);
+  memcpy(edges.data(), data, count * sizeof(edges[0]));
+  for (const auto &edge : edges) {
+    if (edge.GetBegin() >= vertex_count || edge.GetEnd() >= vertex_count) {
+      return false;
+    }
+  }
+  figure.setEdges(std::move(edges));
+  return true;
+}
+
+inline uint64_t Mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+bool GetMtime(const string &path, int64_t &mtime) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) return false;
+  mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  return true;
+}
+}  // namespace
+
+CachedFileReader::CachedFileReader(unique_ptr<BaseFileReader> reader,
+                                   string cache_dir)
+    : reader_(std::move(reader)), cache_dir_(std::move(cache_dir)) {}
+
+uint64_t CachedFileReader::HashContent(const char *data, size_t size) {
+  // Четыре независимые цепочки по 8 байт, чтобы хеш не упирался в
+  // задержку умножения.
+  constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+  constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+  uint64_t lanes[4] = {kPrime1, kPrime2, ~kPrime1, ~kPrime2};
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    for (int lane = 0; lane < 4; ++lane) {
+      uint64_t word;
+      memcpy(&word, data + i + lane * 8, 8);
+      lanes[lane] = std::rotl(lanes[lane] + word * kPrime2, 31) * kPrime1;
+    }
+  }
+  uint64_t h = size;
+  for (int lane = 0; lane < 4; ++lane) {
+    h = (h ^ Mix(lanes[lane])) * kPrime1;
+  }
+  for (; i < size; ++i) {
+    h = (h ^ static_cast<unsigned char>(data[i])) * kPrime2;
+  }
+  return Mix(h);
+}
+
+void CachedFileReader::setProgressCallback(ProgressCallback callback) {
+  reader_->setProgressCallback(callback);
+  BaseFileReader::setProgressCallback(std::move(callback));
+}
+
+void CachedFileReader::setCancellationToken(CancellationToken token) {
+  reader_->setCancellationToken(token);
+  BaseFileReader::setCancellationToken(std::move(token));
+}
+
+void CachedFileReader::setBatchCallback(BatchCallback callback,
+                                        std::chrono::milliseconds interval) {
+  reader_->setBatchCallback(callback, interval);
+  BaseFileReader::setBatchCallback(std::move(callback), interval);
+}
+
+string CachedFileReader::GetCachePath(const string &path) const {
+  if (cache_dir_.empty()) return path + ".3dvc";
+  std::error_code error;
+  string absolute = std::filesystem::absolute(path, error).string();
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.3dvc",
+           static_cast<unsigned long long>(
+               HashContent(absolute.data(), absolute.size())));
+  return (std::filesystem::path(cache_dir_) / name).string();
+}
+
+Scene CachedFileReader::ReadScene(string path,
+                                  NormalizationParameters params) {
+  int64_t mtime;
+  MappedFile source(path);
+  if (!source.IsOpen() || !GetMtime(path, mtime)) {
+    return reader_->ReadScene(path, params);
+  }
+
+  string cache_path = GetCachePath(path);
+  SourceStamp stamp{source.GetSize(), mtime,
+                    HashContent(source.GetData(), source.GetSize())};
+  Scene scene;
+  if (ReadCache(cache_path, stamp, scene)) {
+    ReportProgress(source.GetSize(), source.GetSize(), 0);
+    return scene;
+  }
+
+  scene = reader_->ReadScene(path, params);
+  if (!IsCancelled()) WriteCache(cache_path, stamp, scene);
+  return scene;
+}
+
+bool CachedFileReader::ReadCache(const string &cache_path,
+                                 const SourceStamp &source,
+                                 Scene &scene) const {
+  MappedFile cache(cache_path);
+  if (!cache.IsOpen() || cache.GetSize() < sizeof(CacheHeader)) return false;
+
+  CacheHeader header;
+  memcpy(&header, cache.GetData(), sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.byte_order != kByteOrderMark ||
+      header.source_size != source.size ||
+      header.source_mtime != source.mtime ||
+      header.source_hash != source.hash) {
+    return false;
+  }
+
+  const char *p = cache.GetData() + sizeof(header);
+  const char *end = cache.GetData() + cache.GetSize();
+  Scene result;
+  for (uint64_t f = 0; f < header.figure_count; ++f) {
+    FigureHeader counts;
+    if (size_t(end - p) < sizeof(counts)) return false;
+    memcpy(&counts, p, sizeof(counts));
+    p += sizeof(counts);
+    if (counts.index_size != 2 && counts.index_size != 4 &&
+        counts.index_size != 8) {
+      return false;
+    }
+    // счётчики сверяются с остатком файла делением: произведение
+    // испорченного счётчика на размер записи может переполниться
+    size_t available = end - p;
+    if (counts.vertex_count > available / (3 * sizeof(float))) return false;
+    size_t vertex_bytes = counts.vertex_count * 3 * sizeof(float);
+    available -= vertex_bytes;
+    if (counts.edge_count > available / (2 * counts.index_size)) return false;
+    size_t edge_bytes = counts.edge_count * 2 * counts.index_size;
+
+    const float *positions = reinterpret_cast<const float *>(p);
+    const char *edges = p + vertex_bytes;
+    p += vertex_bytes + edge_bytes;
+
+    auto figure = make_shared<Figure>();
+    bool valid =
+        counts.index_size == 2
+            ? ReadEdges<uint16_t>(edges, counts.edge_count,
+                                  counts.vertex_count, *figure)
+        : counts.index_size == 4
+            ? ReadEdges<uint32_t>(edges, counts.edge_count,
+                                  counts.vertex_count, *figure)
+            : ReadEdges<uint64_t>(edges, counts.edge_count,
+                                  counts.vertex_count, *figure);
+    if (!valid) return false;
+    figure->setPositions(
+        vector<float>(positions, positions + counts.vertex_count * 3));
+    result.setFigures(figure);
+  }
+  scene = std::move(result);
+  return true;
+}
+
+void CachedFileReader::WriteCache(const string &cache_path,
+                                  const SourceStamp &source,
+                                  const Scene &scene) const {
+  std::error_code error;
+  if (!cache_dir_.empty()) {
+    std::filesystem::create_directories(cache_dir_, error);
+  }
+  string tmp_path = cache_path + ".tmp";
+  ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) return;
+
+  CacheHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byte_order = kByteOrderMark;
+  header.source_size = source.size;
+  header.source_mtime = source.mtime;
+  header.source_hash = source.hash;
+  header.figure_count = scene.GetFigures().size();
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  for (auto &figure : scene.GetFigures()) {
+    const vector<float> &positions = figure->GetPositions();
+    FigureHeader counts{figure->GetVertexCount(), figure->GetEdgeCount(),
+                        figure->GetIndexSize()};
+    out.write(reinterpret_cast<const char *>(&counts), sizeof(counts));
+    out.write(reinterpret_cast<const char *>(positions.data()),
+              positions.size() * sizeof(float));
+    figure->VisitEdges([&out](const auto &edges) {
+      out.write(reinterpret_cast<const char *>(edges.data()),
+                edges.size() * sizeof(edges[0]));
+    });
+  }
+
+  out.close();
+  if (!out) {
+    std::filesystem::remove(tmp_path, error);
+    return;
+  }
+  std::filesystem::rename(tmp_path, cache_path, error);
+}
@@ -0,0 +1,224 @@
+#include "model.h"
+
+using namespace viewer;
+
+namespace {
+// Кластеров в одной задаче пула: проверка рамки стоит наносекунды, так
+// что задача по одному кластеру обходилась бы дороже самой проверки.
+constexpr size_t kCullBlock = 64;
+// Ячеек кривой Мортона по каждой оси. Порядок внутри ячейки не важен:
+// кластер из тысяч элементов всё равно охватывает много ячеек.
+constexpr unsigned kMortonBits = 10;
+
+// Разносит младшие kMortonBits бит x через два: abc -> a00b00c.
+uint32_t SpreadBits(uint32_t x) {
+  x = (x | (x << 16)) & 0x030000FF;
+  x = (x | (x << 8)) & 0x0300F00F;
+  x = (x | (x << 4)) & 0x030C30C3;
+  x = (x | (x << 2)) & 0x09249249;
+  return x;
+}
+
+NormalizationParameters EmptyBounds() {
+  NormalizationParameters bounds;
+  bounds.minX = bounds.minY = bounds.minZ = std::numeric_limits<float>::max();
+  bounds.maxX = bounds.maxY = bounds.maxZ =
+      std::numeric_limits<float>::lowest();
+  return bounds;
+}
+
+template <typename Coordinate>
+void ExtendBounds(NormalizationParameters &bounds, const Coordinate *p) {
+  bounds.minX = std::min<float>(bounds.minX, p[0]);
+  bounds.maxX = std::max<float>(bounds.maxX, p[0]);
+  bounds.minY = std::min<float>(bounds.minY, p[1]);
+  bounds.maxY = std::max<float>(bounds.maxY, p[1]);
+  bounds.minZ = std::min<float>(bounds.minZ, p[2]);
+  bounds.maxZ = std::max<float>(bounds.maxZ, p[2]);
+}
+}  // namespace
+
+array<float, 16> viewer::MultiplyColumnMajor(const array<float, 16> &a,
+                                             const array<float, 16> &b) {
+  array<float, 16> result;
+  for (int col = 0; col < 4; ++col) {
+    for (int row = 0; row < 4; ++row) {
+      float sum = 0;
+      for (int k = 0; k < 4; ++k) sum += a[k * 4 + row] * b[col * 4 + k];
+      result[col * 4 + row] = sum;
+    }
+  }
+  return result;
+}
+
+Frustum::Frustum(const array<float, 16> &projection,
+                 const array<float, 16> &view) {
+  array<float, 16> clip = MultiplyColumnMajor(projection, view);
+  // Gribb, Hartmann: -w <= x, y, z <= w - суммы и разности четвёртой
+  // строки матрицы с первыми тремя
+  for (int axis = 0; axis < 3; ++axis) {
+    for (int j = 0; j < 4; ++j) {
+      planes_[axis * 2][j] = clip[j * 4 + 3] + clip[j * 4 + axis];
+      planes_[axis * 2 + 1][j] = clip[j * 4 + 3] - clip[j * 4 + axis];
+    }
+  }
+}
+
+Frustum Frustum::Transformed(const AffineMatrix &model) const {
+  // точка model * p видна, если plane * model * p >= 0
+  const AffineMatrix::Rows &m = model.GetRows();
+  Frustum result;
+  for (size_t i = 0; i < planes_.size(); ++i) {
+    const array<float, 4> &plane = planes_[i];
+    for (int j = 0; j < 4; ++j) {
+      result.planes_[i][j] = plane[0] * m[0][j] + plane[1] * m[1][j] +
+                             plane[2] * m[2][j] + (j == 3 ? plane[3] : 0);
+    }
+  }
+  return result;
+}
+
+bool Frustum::Intersects(const NormalizationParameters &box) const {
+  for (const auto &plane : planes_) {
+    // угол рамки, дальше всех продвинутый по нормали плоскости
+    float x = plane[0] >= 0 ? box.maxX : box.minX;
+    float y = plane[1] >= 0 ? box.maxY : box.minY;
+    float z = plane[2] >= 0 ? box.maxZ : box.minZ;
+    if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void viewer::CullClusters(std::span<const Cluster> clusters,
+                          const Frustum &frustum, vector<IndexRange> &visible,
+                          WorkerPool &pool) {
+  // флаги живут между кадрами, чтобы отсечение не выделяло память
+  // (ParallelFor тело не копирует); потоки пула пишут во флаги
+  // вызывающего потока через ссылку
+  static thread_local vector<uint8_t> storage;
+  vector<uint8_t> &flags = storage;
+  flags.resize(clusters.size());
+  size_t blocks = (clusters.size() + kCullBlock - 1) / kCullBlock;
+  pool.ParallelFor(blocks, [&](size_t block) {
+    size_t end = std::min(clusters.size(), (block + 1) * kCullBlock);
+    for (size_t i = block * kCullBlock; i < end; ++i) {
+      flags[i] = frustum.Intersects(clusters[i].bounds);
+    }
+  });
+  visible.clear();
+  for (size_t i = 0; i < clusters.size(); ++i) {
+    if (!flags[i]) continue;
+    const IndexRange &range = clusters[i].range;
+    if (!visible.empty() && visible.back().end == range.begin) {
+      visible.back().end = range.end;
+    } else {
+      visible.push_back(range);
+    }
+  }
+}
+
+void Figure::BuildClusters(size_t cluster_size) {
+  size_t vertex_count = GetVertexCount();
+  size_t edge_count = GetEdgeCount();
+  if (vertex_count == 0 || cluster_size == 0 ||
+      vertex_count > std::numeric_limits<uint32_t>::max() ||
+      !HasValidEdges()) {
+    return;
+  }
+
+  // код Мортона ячейки в старших 32 битах, номер вершины в младших
+  vector<uint64_t> order(vertex_count);
+  VisitPositions([&](auto positions) {
+    NormalizationParameters bounds = EmptyBounds();
+    for (size_t v = 0; v < vertex_count; ++v) {
+      ExtendBounds(bounds, &positions[v * 3]);
+    }
+    const float min[3] = {bounds.minX, bounds.minY, bounds.minZ};
+    const float max[3] = {bounds.maxX, bounds.maxY, bounds.maxZ};
+    float scale[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      float extent = max[axis] - min[axis];
+      scale[axis] = extent > 0 ? ((1 << kMortonBits) - 1) / extent : 0;
+    }
+    for (size_t v = 0; v < vertex_count; ++v) {
+      uint32_t code = 0;
+      for (int axis = 0; axis < 3; ++axis) {
+        auto cell = uint32_t((positions[v * 3 + axis] - min[axis]) *
+                             scale[axis]);
+        code |= SpreadBits(cell) << axis;
+      }
+      order[v] = uint64_t(code) << 32 | v;
+    }
+  });
+  std::sort(order.begin(), order.end());
+
+  // вершины в новом порядке; remap - новый номер по старому
+  vector<uint32_t> remap(vertex_count);
+  auto reorder = [&](auto &stored) {
+    std::decay_t<decltype(stored)> sorted(stored.size());
+    for (size_t v = 0; v < vertex_count; ++v) {
+      uint32_t old = uint32_t(order[v]);
+      remap[old] = v;
+      std::copy_n(&stored[old * 3], 3, &sorted[v * 3]);
+    }
+    stored.swap(sorted);
+  };
+  if (IsQuantized()) {
+    reorder(quantized_);
+  } else {
+    reorder(positions_);
+  }
+  vector<uint64_t>().swap(order);
+  std::visit(
+      [&](auto &edges) {
+        using Index = decltype(edges[0].GetBegin());
+        for (auto &edge : edges) {
+          edge.setBegin(Index(remap[edge.GetBegin()]));
+          edge.setEnd(Index(remap[edge.GetEnd()]));
+        }
+        // std::minmax вернул бы ссылки на временные номера
+        auto key = [](const auto &edge) {
+          Index a = edge.GetBegin();
+          Index b = edge.GetEnd();
+          return std::pair(std::min(a, b), std::max(a, b));
+        };
+        std::sort(edges.begin(), edges.end(),
+                  [&key](const auto &a, const auto &b) {
+                    return key(a) < key(b);
+                  });
+      },
+      edges_);
+  vector<uint32_t>().swap(remap);
+
+  MarkVerticesDirty(0, vertex_count);
+  MarkEdgesDirty(0, edge_count);
+  VisitPositions([&](auto positions) {
+    for (size_t begin = 0; begin < vertex_count; begin += cluster_size) {
+      Cluster cluster{{begin, std::min(vertex_count, begin + cluster_size)},
+                      EmptyBounds()};
+      for (size_t v = cluster.range.begin; v < cluster.range.end; ++v) {
+        ExtendBounds(cluster.bounds, &positions[v * 3]);
+      }
+      vertexClusters_.push_back(cluster);
+    }
+    VisitEdges([&](auto edges) {
+      for (size_t begin = 0; begin < edge_count; begin += cluster_size) {
+        Cluster cluster{{begin, std::min(edge_count, begin + cluster_size)},
+                        EmptyBounds()};
+        for (size_t e = cluster.range.begin; e < cluster.range.end; ++e) {
+          ExtendBounds(cluster.bounds, &positions[edges[e].GetBegin() * 3]);
+          ExtendBounds(cluster.bounds, &positions[edges[e].GetEnd() * 3]);
+        }
+        edgeClusters_.push_back(cluster);
+      }
+    });
+  });
+}
+
+void Scene::BuildClusters() {
+  for (auto &figure : figures_) {
+    figure->BuildClusters();
+  }
+}
@@ -1,27 +1,27 @@
 #include "model.h"
 using namespace viewer;
 
-void Edge::setBegin(Vertex *v) { begin_ = v; }
-
-void Edge::setEnd(Vertex *v) { end_ = v; }
-
-Vertex *Edge::GetBegin() const { return begin_; }
-Vertex *Edge::GetEnd() const { return end_; }
-
-bool Edge::operator<(const Edge &other) const {
-  if (*begin_ != *other.begin_) {
-    return *begin_ < *other.begin_;
+template <typename Index>
+bool BasicEdge<Index>::operator<(const BasicEdge &other) const {
+  if (begin_ != other.begin_) {
+    return begin_ < other.begin_;
   }
-  return *end_ < *other.end_;
+  return end_ < other.end_;
 }
 
-bool Edge::operator>(const Edge &other) const {
-  if (*begin_ != *other.begin_) {
-    return *begin_ > *other.begin_;
+template <typename Index>
+bool BasicEdge<Index>::operator>(const BasicEdge &other) const {
+  if (begin_ != other.begin_) {
+    return begin_ > other.begin_;
   }
-  return *end_ > *other.end_;
+  return end_ > other.end_;
+}
+
+template <typename Index>
+bool BasicEdge<Index>::operator==(const BasicEdge &other) const {
+  return begin_ == other.begin_ && end_ == other.end_;
 }
 
-bool Edge::operator==(const Edge &other) const {
-  return (*begin_ == *other.begin_ && *end_ == *other.end_);
-}
\ No newline at end of file
+template class viewer::BasicEdge<uint16_t>;
+template class viewer::BasicEdge<uint32_t>;
+template class viewer::BasicEdge<uint64_t>;
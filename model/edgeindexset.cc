@@ -0,0 +1,54 @@
+#include "model.h"
+using namespace viewer;
+
+namespace {
+constexpr size_t kMinCapacity = 16;
+}
+
+EdgeIndexSet::EdgeIndexSet() { Rehash(kMinCapacity); }
+
+bool EdgeIndexSet::Insert(uint32_t a, uint32_t b) {
+  uint64_t key = MakeKey(a, b);
+  size_t mask = slots_.size() - 1;
+  size_t slot = (key * 0x9E3779B97F4A7C15ull) >> shift_;
+  while (slots_[slot] != kEmpty) {
+    if (slots_[slot] == key) return false;
+    slot = (slot + 1) & mask;
+  }
+  slots_[slot] = key;
+  keys_.push_back(key);
+  if (keys_.size() * 2 > slots_.size()) {
+    Rehash(slots_.size() * 2);
+  }
+  return true;
+}
+
+EdgeArray EdgeIndexSet::ToEdgeArray(size_t vertex_count) const {
+  return DispatchIndexWidth(vertex_count, [&](auto index) -> EdgeArray {
+    using Index = decltype(index);
+    vector<BasicEdge<Index>> edges;
+    edges.reserve(keys_.size());
+    for (uint64_t key : keys_) {
+      edges.emplace_back(Index(key >> 32), Index(key & 0xFFFFFFFFu));
+    }
+    return edges;
+  });
+}
+
+void EdgeIndexSet::Reserve(size_t count) {
+  keys_.reserve(count);
+  size_t capacity = kMinCapacity;
+  while (capacity < count * 2) capacity *= 2;
+  if (capacity > slots_.size()) Rehash(capacity);
+}
+
+void EdgeIndexSet::Rehash(size_t capacity) {
+  slots_.assign(capacity, kEmpty);
+  shift_ = 64 - std::countr_zero(capacity);
+  size_t mask = capacity - 1;
+  for (uint64_t key : keys_) {
+    size_t slot = (key * 0x9E3779B97F4A7C15ull) >> shift_;
+    while (slots_[slot] != kEmpty) slot = (slot + 1) & mask;
+    slots_[slot] = key;
+  }
+}
@@ -0,0 +1,114 @@
+#include "model.h"
+
+using namespace viewer;
+
+namespace {
+// Рёбра, сходящиеся в каждой вершине, в виде CSR: номера рёбер вершины v
+// лежат в incident[offsets[v], offsets[v + 1]).
+class EdgeGraph {
+ public:
+  template <typename Edges>
+  EdgeGraph(const Edges &edges, size_t vertex_count)
+      : offsets_(vertex_count + 1), incident_(edges.size() * 2),
+        used_(edges.size()) {
+    for (const auto &edge : edges) {
+      ++offsets_[edge.GetBegin() + 1];
+      ++offsets_[edge.GetEnd() + 1];
+    }
+    for (size_t v = 0; v < vertex_count; ++v) offsets_[v + 1] += offsets_[v];
+    cursor_.assign(offsets_.begin(), offsets_.end() - 1);
+    for (uint32_t e = 0; e < edges.size(); ++e) {
+      incident_[cursor_[edges[e].GetBegin()]++] = e;
+      incident_[cursor_[edges[e].GetEnd()]++] = e;
+    }
+    cursor_.assign(offsets_.begin(), offsets_.end() - 1);
+  }
+
+  size_t GetDegree(size_t v) const { return offsets_[v + 1] - offsets_[v]; }
+  // Очередное неиспользованное ребро вершины v, помечаемое
+  // использованным; false, если таких нет. Каждая вершина просматривает
+  // свой список один раз за весь проход.
+  bool TakeEdge(size_t v, uint32_t &edge) {
+    for (size_t &i = cursor_[v]; i < offsets_[v + 1]; ++i) {
+      if (used_[incident_[i]]) continue;
+      edge = incident_[i];
+      used_[edge] = true;
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  vector<size_t> offsets_;
+  vector<size_t> cursor_;
+  vector<uint32_t> incident_;
+  vector<bool> used_;
+};
+}  // namespace
+
+// Жадный обход: ломаная идёт от вершины по неиспользованным рёбрам, пока
+// не упрётся, затем продолжается в другую сторону от начала. Сначала
+// обходятся вершины нечётной степени, в которых кончаются эйлеровы пути,
+// так что на сетках из треугольников и четырёхугольников ломаные
+// получаются длинными и передача вершин сокращается почти вдвое.
+void Figure::BuildStrips() {
+  if (GetEdgeCount() == 0 ||
+      GetEdgeCount() > std::numeric_limits<uint32_t>::max()) {
+    return;
+  }
+  StripArray strips = VisitEdges([this](auto edges) -> StripArray {
+    // AddEdge не проверяет, что вершины уже добавлены
+    uint64_t vertex_count = GetVertexCount();
+    for (const auto &edge : edges) {
+      vertex_count = std::max<uint64_t>(
+          vertex_count, std::max<uint64_t>(edge.GetBegin(), edge.GetEnd()) + 1);
+    }
+    EdgeGraph graph(edges, vertex_count);
+    auto other = [&edges](uint32_t e, uint64_t v) -> uint64_t {
+      return edges[e].GetBegin() == v ? edges[e].GetEnd()
+                                      : edges[e].GetBegin();
+    };
+    // наибольшее значение типа не должно быть номером вершины
+    return DispatchIndexWidth(vertex_count + 1,
+                              [&](auto index) -> StripArray {
+      using Index = decltype(index);
+      constexpr Index kRestart = std::numeric_limits<Index>::max();
+      vector<Index> result;
+      result.reserve(edges.size() + edges.size() / 2);
+      vector<Index> backward;
+      auto walk = [&](uint64_t v, auto emit) {
+        uint32_t e;
+        while (graph.TakeEdge(v, e)) {
+          v = other(e, v);
+          emit(Index(v));
+        }
+      };
+      auto start_strips = [&](uint64_t v) {
+        uint32_t e;
+        while (graph.TakeEdge(v, e)) {
+          if (!result.empty()) result.push_back(kRestart);
+          // ход назад от v, затем v, ребро e и ход вперёд
+          backward.clear();
+          walk(v, [&backward](Index i) { backward.push_back(i); });
+          result.insert(result.end(), backward.rbegin(), backward.rend());
+          result.push_back(Index(v));
+          result.push_back(Index(other(e, v)));
+          walk(other(e, v), [&result](Index i) { result.push_back(i); });
+        }
+      };
+      for (uint64_t v = 0; v < vertex_count; ++v) {
+        if (graph.GetDegree(v) % 2 == 1) start_strips(v);
+      }
+      for (uint64_t v = 0; v < vertex_count; ++v) start_strips(v);
+      result.shrink_to_fit();
+      return result;
+    });
+  });
+  strips_ = std::move(strips);
+}
+
+void Scene::BuildStrips() {
+  for (auto &figure : figures_) {
+    figure->BuildStrips();
+  }
+}
@@ -3,46 +3,240 @@
 using namespace viewer;
 
 void Figure::Transform() {
-  TransformMatrix matrixFinale;
-  matrixFinale =
-      TransformMatrixBuilder::CreateMoveMatrix(move_[0], move_[1], move_[2]) *
-      TransformMatrixBuilder::CreateRotationMatrix(rotate_[0], rotate_[1],
-                                                   rotate_[2]) *
-      TransformMatrixBuilder::CreateScaleMatrix(scale_[0], scale_[1],
-                                                scale_[2]);
-  for (size_t i = 0; i < dataVertices_.size(); i++) {
-    vertices_[i]->setPosition(
-        matrixFinale.TransformPoint(dataVertices_[i].GetPosition()));
+  modelMatrix_ = AffineMatrix::FromTrs(move_, rotate_, scale_) * dequantize_;
+  transformDirty_ = false;
+}
+
+float Figure::Quantize(const NormalizationParameters &bounds) {
+  if (IsQuantized() || positions_.empty()) return 0;
+  const float min[3] = {bounds.minX, bounds.minY, bounds.minZ};
+  const float max[3] = {bounds.maxX, bounds.maxY, bounds.maxZ};
+  float center[3], step[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    center[axis] = min[axis] + (max[axis] - min[axis]) / 2;
+    step[axis] = (max[axis] - min[axis]) / 65534;
+    if (!(step[axis] > 0)) step[axis] = 1;
+  }
+
+  quantized_.resize(positions_.size());
+  float error = 0;
+  for (size_t i = 0; i < positions_.size(); ++i) {
+    int axis = i % 3;
+    float q = std::nearbyint((positions_[i] - center[axis]) / step[axis]);
+    q = std::clamp(q, -32767.0f, 32767.0f);
+    quantized_[i] = int16_t(q);
+    // так же, как восстановит матрица модели
+    float restored = step[axis] * q + center[axis];
+    error = std::max(error, std::abs(restored - positions_[i]));
+  }
+  vector<float>().swap(positions_);
+  dequantize_ = AffineMatrix::Translation(center[0], center[1], center[2]) *
+                AffineMatrix::Scaling(step[0], step[1], step[2]);
+  MarkVerticesDirty(0, GetVertexCount());
+  Transform();
+  return error;
+}
+
+void Figure::Dequantize() {
+  size_t count = GetVertexCount();
+  // номера узлов решётки переводятся в float и восстанавливаются на
+  // месте пакетным преобразованием
+  positions_.assign(quantized_.begin(), quantized_.end());
+  vector<int16_t>().swap(quantized_);
+  dequantize_.TransformPoints(positions_.data(), positions_.data(), count);
+  dequantize_ = AffineMatrix();
+  MarkVerticesDirty(0, count);
+  Transform();
+}
+
+MemoryUsage Figure::GetMemoryUsage() const {
+  MemoryUsage usage;
+  usage.vertices = positions_.capacity() * sizeof(float) +
+                   quantized_.capacity() * sizeof(int16_t) +
+                   vertexClusters_.capacity() * sizeof(Cluster);
+  auto bytes = [](const auto &array) {
+    return array.capacity() * sizeof(array[0]);
+  };
+  // ломаные - те же рёбра в другом порядке
+  usage.edges = std::visit(bytes, edges_) + std::visit(bytes, strips_) +
+                bytes(edgeClusters_);
+  for (const LodLevel &lod : lods_) usage += lod.figure->GetMemoryUsage();
+  return usage;
+}
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &other) {
+  vertices += other.vertices;
+  edges += other.edges;
+  return *this;
+}
+
+bool Scene::Transform() {
+  bool transformed = false;
+  for (auto &figure : figures_) {
+    if (!figure->IsTransformDirty()) continue;
+    figure->Transform();
+    transformed = true;
   }
+  return transformed;
 }
 
-void Figure::setEdges(const Edge &edge) {
-  edges_.emplace_back(std::move(edge));
+float Scene::Quantize() {
+  NormalizationParameters bounds;
+  bounds.minX = bounds.minY = bounds.minZ = std::numeric_limits<float>::max();
+  bounds.maxX = bounds.maxY = bounds.maxZ =
+      std::numeric_limits<float>::lowest();
+  for (auto &figure : figures_) {
+    const vector<float> &positions = figure->GetPositions();
+    for (size_t i = 0; i < positions.size(); i += 3) {
+      bounds.minX = std::min(bounds.minX, positions[i]);
+      bounds.maxX = std::max(bounds.maxX, positions[i]);
+      bounds.minY = std::min(bounds.minY, positions[i + 1]);
+      bounds.maxY = std::max(bounds.maxY, positions[i + 1]);
+      bounds.minZ = std::min(bounds.minZ, positions[i + 2]);
+      bounds.maxZ = std::max(bounds.maxZ, positions[i + 2]);
+    }
+  }
+  for (auto &figure : figures_) {
+    quantizationError_ =
+        std::max(quantizationError_, figure->Quantize(bounds));
+  }
+  return quantizationError_;
 }
 
-void Figure::setVertices(const shared_ptr<Vertex> &vertex) {
-  vertices_.emplace_back(std::move(vertex));
+MemoryUsage Scene::GetMemoryUsage() const {
+  MemoryUsage usage;
+  for (auto &figure : figures_) {
+    usage += figure->GetMemoryUsage();
+  }
+  return usage;
 }
-void Figure::setDataVertices(const Vertex &vertex) {
-  dataVertices_.emplace_back(std::move(vertex));
+
+ThreeDPoint Figure::GetVertex(size_t index) const {
+  return modelMatrix_.TransformPoint(GetStoredVertex(index));
 }
 
-vector<Edge> Figure::GetEdges() { return edges_; }
+ThreeDPoint Figure::GetDataVertex(size_t index) const {
+  return dequantize_.TransformPoint(GetStoredVertex(index));
+}
+
+ThreeDPoint Figure::GetStoredVertex(size_t index) const {
+  return VisitPositions([index](const auto &positions) {
+    return ThreeDPoint(positions[index * 3], positions[index * 3 + 1],
+                       positions[index * 3 + 2]);
+  });
+}
+
+bool Figure::HasValidEdges() const {
+  size_t vertex_count = GetVertexCount();
+  return VisitEdges([vertex_count](auto edges) {
+    return std::all_of(edges.begin(), edges.end(), [&](const auto &edge) {
+      return edge.GetBegin() < vertex_count && edge.GetEnd() < vertex_count;
+    });
+  });
+}
 
-vector<shared_ptr<Vertex>> Figure::GetVertices() { return vertices_; }
+void Figure::AddVertex(const ThreeDPoint &position) {
+  if (IsQuantized()) Dequantize();
+  positions_.insert(positions_.end(), {position.x, position.y, position.z});
+  MarkVerticesDirty(GetVertexCount() - 1, GetVertexCount());
+}
+
+size_t Figure::GetEdgeCount() const {
+  return VisitEdges([](const auto &edges) { return edges.size(); });
+}
+
+Edge64 Figure::GetEdge(size_t index) const {
+  return VisitEdges([index](const auto &edges) {
+    return Edge64(edges[index].GetBegin(), edges[index].GetEnd());
+  });
+}
+
+size_t Figure::GetIndexSize() const {
+  return VisitEdges(
+      [](const auto &edges) { return sizeof(edges[0].GetBegin()); });
+}
+
+void Figure::AddEdge(uint64_t begin, uint64_t end) {
+  DispatchIndexWidth(std::max(begin, end) + 1, [&](auto index) {
+    using Needed = decltype(index);
+    if (sizeof(Needed) <= GetIndexSize()) return;
+    // другой тип номеров - все рёбра переписываются
+    MarkEdgesDirty(0, GetEdgeCount());
+    edges_ = VisitEdges([](const auto &edges) {
+      vector<BasicEdge<Needed>> wider;
+      wider.reserve(edges.size() + 1);
+      for (const auto &edge : edges) {
+        wider.emplace_back(edge.GetBegin(), edge.GetEnd());
+      }
+      return wider;
+    });
+  });
+  std::visit(
+      [&](auto &edges) {
+        using Index = decltype(edges[0].GetBegin());
+        edges.emplace_back(Index(begin), Index(end));
+      },
+      edges_);
+  MarkEdgesDirty(GetEdgeCount() - 1, GetEdgeCount());
+}
+
+void Figure::setPositions(vector<float> positions) {
+  positions_ = std::move(positions);
+  if (IsQuantized()) {
+    vector<int16_t>().swap(quantized_);
+    dequantize_ = AffineMatrix();
+    Transform();
+  }
+  MarkVerticesDirty(0, GetVertexCount());
+}
+
+void Figure::ClearDirtyRanges() {
+  dirtyBaseVersion_ = geometryVersion_;
+  dirtyVertices_ = IndexRange();
+  dirtyEdges_ = IndexRange();
+}
+
+void Figure::MarkVerticesDirty(size_t first, size_t last) {
+  vector<Cluster>().swap(edgeClusters_);
+  vector<Cluster>().swap(vertexClusters_);
+  vector<LodLevel>().swap(lods_);
+  dirtyVertices_.Extend(first, last);
+  ++geometryVersion_;
+}
+
+void Figure::MarkEdgesDirty(size_t first, size_t last) {
+  strips_ = vector<uint16_t>();
+  vector<Cluster>().swap(edgeClusters_);
+  vector<Cluster>().swap(vertexClusters_);
+  vector<LodLevel>().swap(lods_);
+  dirtyEdges_.Extend(first, last);
+  ++geometryVersion_;
+}
+
+void IndexRange::Extend(size_t first, size_t last) {
+  if (first >= last) return;
+  if (IsEmpty()) {
+    begin = first;
+    end = last;
+  } else {
+    begin = std::min(begin, first);
+    end = std::max(end, last);
+  }
+}
 
+// Повторная установка тех же значений не требует пересчёта.
 void Figure::setRotate(float x, float y, float z) {
-  rotate_[0] = x;
-  rotate_[1] = y;
-  rotate_[2] = z;
+  array<float, 3> rotate = {x, y, z};
+  transformDirty_ |= rotate != rotate_;
+  rotate_ = rotate;
 }
 void Figure::setMove(float x, float y, float z) {
-  move_[0] = x;
-  move_[1] = y;
-  move_[2] = z;
+  array<float, 3> move = {x, y, z};
+  transformDirty_ |= move != move_;
+  move_ = move;
 }
 void Figure::setScale(float x) {
-  scale_[0] = x;
-  scale_[1] = x;
-  scale_[2] = x;
+  array<float, 3> scale = {x, x, x};
+  transformDirty_ |= scale != scale_;
+  scale_ = scale;
 }
@@ -0,0 +1,48 @@
+#include <cctype>
+#include <cstring>
+
+#include "model.h"
+using namespace viewer;
+
+namespace {
+bool HasExtension(const string &path, const char *ext) {
+  size_t n = strlen(ext);
+  if (path.size() < n) return false;
+  for (size_t i = 0; i < n; ++i) {
+    // tolower от отрицательного char (UTF-8 в имени) не определён
+    unsigned char c = path[path.size() - n + i];
+    if (tolower(c) != ext[i]) return false;
+  }
+  return true;
+}
+}  // namespace
+
+FileFormat viewer::DetectFileFormat(const string &path) {
+  if (path == "-") return FileFormat::kObjStream;
+
+  ifstream in(path, std::ios::binary);
+  char head[84] = {};
+  in.read(head, sizeof(head));
+  size_t got = in.gcount();
+  if (got >= 2 && uint8_t(head[0]) == 0x1f && uint8_t(head[1]) == 0x8b) {
+    return FileFormat::kObjStream;
+  }
+  if (got >= 4 && memcmp(head, "ply", 3) == 0 &&
+      (head[3] == '\n' || head[3] == '\r')) {
+    return FileFormat::kPly;
+  }
+  if (got == sizeof(head)) {
+    // у двоичного STL размер однозначно задан числом треугольников
+    uint32_t count = LoadUnaligned<uint32_t>(head + 80);
+    in.seekg(0, std::ios::end);
+    if (size_t(in.tellg()) == 84 + 50 * uint64_t(count)) {
+      return FileFormat::kStl;
+    }
+  }
+
+  if (HasExtension(path, ".gz")) return FileFormat::kObjStream;
+  // текстовый STL и двоичный неверного размера разбирает StlFileReader
+  if (HasExtension(path, ".stl")) return FileFormat::kStl;
+  if (HasExtension(path, ".ply")) return FileFormat::kPly;
+  return FileFormat::kObj;
+}
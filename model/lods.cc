@@ -0,0 +1,207 @@
+#include "model.h"
+
+using namespace viewer;
+
+namespace {
+// Самая мелкая и самая грубая сетки уровней: 512 и 16 ячеек по длинной
+// стороне рамки фигуры. Номер ячейки по оси занимает 10 бит ключа.
+constexpr unsigned kFinestLodBits = 9;
+constexpr unsigned kCoarsestLodBits = 4;
+constexpr unsigned kCellKeyBits = 10;
+
+// Уровень в процессе построения: позиции в типе хранения фигуры, число
+// исходных вершин, стянутых в каждую (для взвешенного среднего), и
+// рёбра как begin << 32 | end при begin < end.
+template <typename Coordinate>
+struct Simplified {
+  vector<Coordinate> positions;
+  vector<uint32_t> weights;
+  vector<uint64_t> edges;
+};
+
+std::pair<uint64_t, uint64_t> EdgeEnds(uint64_t edge) {
+  return {edge >> 32, uint32_t(edge)};
+}
+
+template <typename Index>
+std::pair<uint64_t, uint64_t> EdgeEnds(const BasicEdge<Index> &edge) {
+  return {edge.GetBegin(), edge.GetEnd()};
+}
+
+// Стягивает вершины в ячейки сетки cells^3 со стороной cell от origin.
+// Пустой weights - все вершины исходные. Следующий уровень строится из
+// предыдущего: его ячейки - объединения ячеек предыдущего, а средние
+// лежат внутри своих ячеек, так что разбиение выходит то же, что из
+// исходных вершин, за долю их стоимости.
+template <typename Coordinate, typename Edges>
+Simplified<Coordinate> Collapse(std::span<const Coordinate> positions,
+                                std::span<const uint32_t> weights,
+                                Edges edges, const float origin[3],
+                                float cell, uint32_t cells) {
+  size_t count = positions.size() / 3;
+  // ключ ячейки в старших 32 битах, номер вершины в младших
+  vector<uint64_t> order(count);
+  for (size_t v = 0; v < count; ++v) {
+    uint64_t key = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      float offset = std::floor((positions[v * 3 + axis] - origin[axis]) /
+                                cell);
+      auto index = uint32_t(std::clamp(offset, 0.0f, float(cells - 1)));
+      key |= uint64_t(index) << (axis * kCellKeyBits);
+    }
+    order[v] = key << 32 | v;
+  }
+  std::sort(order.begin(), order.end());
+
+  Simplified<Coordinate> result;
+  vector<uint32_t> remap(count);
+  vector<double> sums;
+  for (size_t i = 0; i < count; ++i) {
+    if (i == 0 || order[i] >> 32 != order[i - 1] >> 32) {
+      result.weights.push_back(0);
+      sums.insert(sums.end(), {0, 0, 0});
+    }
+    auto v = uint32_t(order[i]);
+    uint32_t weight = weights.empty() ? 1 : weights[v];
+    size_t target = result.weights.size() - 1;
+    remap[v] = uint32_t(target);
+    result.weights.back() += weight;
+    for (int axis = 0; axis < 3; ++axis) {
+      sums[target * 3 + axis] += double(positions[v * 3 + axis]) * weight;
+    }
+  }
+  vector<uint64_t>().swap(order);
+  result.positions.resize(sums.size());
+  for (size_t i = 0; i < sums.size(); ++i) {
+    double mean = sums[i] / result.weights[i / 3];
+    if constexpr (std::is_integral_v<Coordinate>) mean = std::nearbyint(mean);
+    result.positions[i] = Coordinate(mean);
+  }
+
+  // рёбра внутри ячейки вырождаются в точку, совпавшие сливаются
+  for (const auto &edge : edges) {
+    auto [begin, end] = EdgeEnds(edge);
+    uint64_t a = remap[begin];
+    uint64_t b = remap[end];
+    if (a == b) continue;
+    result.edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+  }
+  std::sort(result.edges.begin(), result.edges.end());
+  result.edges.erase(std::unique(result.edges.begin(), result.edges.end()),
+                     result.edges.end());
+  result.edges.shrink_to_fit();
+  return result;
+}
+}  // namespace
+
+void Figure::BuildLods() {
+  vector<LodLevel>().swap(lods_);
+  size_t vertex_count = GetVertexCount();
+  size_t edge_count = GetEdgeCount();
+  if (edge_count < kLodMinEdges ||
+      vertex_count > std::numeric_limits<uint32_t>::max() ||
+      !HasValidEdges()) {
+    return;
+  }
+  VisitPositions([&](auto positions) {
+    using Coordinate = std::remove_const_t<
+        typename decltype(positions)::element_type>;
+    float min[3], max[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      min[axis] = std::numeric_limits<float>::max();
+      max[axis] = std::numeric_limits<float>::lowest();
+    }
+    for (size_t i = 0; i < positions.size(); ++i) {
+      min[i % 3] = std::min<float>(min[i % 3], positions[i]);
+      max[i % 3] = std::max<float>(max[i % 3], positions[i]);
+    }
+    lodCenter_ = ThreeDPoint((min[0] + max[0]) / 2, (min[1] + max[1]) / 2,
+                             (min[2] + max[2]) / 2);
+    float extent =
+        std::max({max[0] - min[0], max[1] - min[1], max[2] - min[2]});
+    if (!(extent > 0)) return;
+
+    auto keep = [&](const Simplified<Coordinate> &level, float cell) {
+      auto lod = std::make_shared<Figure>();
+      if constexpr (std::is_same_v<Coordinate, int16_t>) {
+        lod->quantized_ = level.positions;
+        lod->dequantize_ = dequantize_;
+        lod->Transform();
+      } else {
+        lod->positions_ = level.positions;
+      }
+      DispatchIndexWidth(level.weights.size(), [&](auto index) {
+        using Index = decltype(index);
+        vector<BasicEdge<Index>> edges;
+        edges.reserve(level.edges.size());
+        for (uint64_t edge : level.edges) {
+          edges.emplace_back(Index(edge >> 32), Index(uint32_t(edge)));
+        }
+        lod->edges_ = std::move(edges);
+      });
+      lods_.push_back({std::move(lod), cell});
+    };
+
+    VisitEdges([&](auto edges) {
+      uint32_t cells = 1u << kFinestLodBits;
+      float cell = extent / cells;
+      Simplified<Coordinate> level =
+          Collapse(positions, {}, edges, min, cell, cells);
+      size_t previous = edge_count;
+      for (unsigned bits = kFinestLodBits;; --bits) {
+        if (level.edges.size() * 2 <= previous) {
+          keep(level, cell);
+          previous = level.edges.size();
+        }
+        if (bits == kCoarsestLodBits) break;
+        cells /= 2;
+        cell *= 2;
+        level = Collapse(std::span<const Coordinate>(level.positions),
+                         std::span<const uint32_t>(level.weights),
+                         std::span<const uint64_t>(level.edges), min, cell,
+                         cells);
+      }
+    });
+  });
+}
+
+size_t Figure::SelectLod(const array<float, 16> &projection,
+                         const array<float, 16> &view, float width,
+                         float height, size_t current) const {
+  if (lods_.empty()) return 0;
+  array<float, 16> clip = MultiplyColumnMajor(
+      MultiplyColumnMajor(projection, view), modelMatrix_.GetColumnMajor());
+  const ThreeDPoint &p = lodCenter_;
+  float c[4];
+  for (int row = 0; row < 4; ++row) {
+    c[row] = clip[row] * p.x + clip[4 + row] * p.y + clip[8 + row] * p.z +
+             clip[12 + row];
+  }
+  // центр за камерой - масштаб не определён, рисуется сама фигура
+  if (!(c[3] > 0)) return 0;
+  // пикселей на единицу координат хранения: производная экранной точки
+  // x / w, y / w по каждой оси, наибольшая из трёх
+  float scale = 0;
+  for (int axis = 0; axis < 3; ++axis) {
+    const float *column = &clip[axis * 4];
+    float dx = (column[0] * c[3] - c[0] * column[3]) / (c[3] * c[3]);
+    float dy = (column[1] * c[3] - c[1] * column[3]) / (c[3] * c[3]);
+    scale = std::max(scale, std::hypot(dx * width / 2, dy * height / 2));
+  }
+  auto error = [&](size_t level) {
+    return level == 0 ? 0 : lods_[level - 1].cellSize * scale;
+  };
+  size_t level = std::min(current, lods_.size());
+  while (level > 0 && error(level) > kLodPixels * kLodHysteresis) --level;
+  while (level < lods_.size() &&
+         error(level + 1) <= kLodPixels / kLodHysteresis) {
+    ++level;
+  }
+  return level;
+}
+
+void Scene::BuildLods() {
+  for (auto &figure : figures_) {
+    figure->BuildLods();
+  }
+}
@@ -0,0 +1,40 @@
+#include <cstring>
+
+#include "model.h"
+using namespace viewer;
+
+Scene MappedFileReader::ReadScene(string path,
+                                  NormalizationParameters params) {
+  (void)params;
+  SceneBuilder builder;
+  MappedFile file(path);
+  if (!file.IsOpen()) return builder.Build();
+
+  const char *p = file.GetData();
+  const char *end = p + file.GetSize();
+  size_t vertex_count, face_count;
+  ObjRecordParser::CountRecords(p, end, vertex_count, face_count);
+  builder.Reserve(vertex_count, face_count);
+
+  vector<int> numbers;
+  numbers.reserve(5);
+  size_t records = 0;
+  const char *next_report = p + kProgressStep;
+  while (p < end) {
+    if (p >= next_report) {
+      if (IsCancelled()) return Scene();
+      ReportProgress(p - file.GetData(), file.GetSize(), records);
+      PublishBatch(builder);
+      next_report = p + kProgressStep;
+    }
+    const char *eol =
+        static_cast<const char *>(memchr(p, '\n', end - p));
+    if (!eol) eol = end;
+    records += ObjRecordParser::ParseLine(p, eol, builder, numbers);
+    p = eol + 1;
+  }
+  if (IsCancelled()) return Scene();
+  ReportProgress(file.GetSize(), file.GetSize(), records);
+  PublishBatch(builder, true);
+  return builder.Build();
+}
@@ -3,28 +3,61 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <span>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <variant>
 #include <vector>
 
 using namespace std;
 
 namespace viewer {
+// Память, занятая геометрией фигуры, в байтах.
+struct MemoryUsage {
+  size_t vertices = 0;
+  size_t edges = 0;
+  size_t Total() const { return vertices + edges; }
+  MemoryUsage &operator+=(const MemoryUsage &other);
+};
+
+// Полуинтервал [begin, end) номеров вершин или рёбер.
+struct IndexRange {
+  size_t begin = 0;
+  size_t end = 0;
+  bool IsEmpty() const { return begin >= end; }
+  // Расширяет диапазон до покрытия [first, last).
+  void Extend(size_t first, size_t last);
+};
+
 struct SceneInfo {
   int vertex_count;
   int edge_count;
+  MemoryUsage memory;
+  // наибольшее отклонение квантованной координаты от исходной, 0 без
+  // квантования
+  float quantization_error = 0;
   string file_name;
 };
 
 class ThreeDPoint {
  public:
-  ThreeDPoint(float x, float y, float z) : x(x), y(y), z(z) {}
+  constexpr ThreeDPoint(float x, float y, float z) : x(x), y(y), z(z) {}
   float x;
   float y;
   float z;
@@ -33,9 +66,105 @@ class ThreeDPoint {
   bool operator>(const ThreeDPoint &other) const;
 };
 
+// Наборы инструкций пакетного преобразования точек, по возрастанию.
+enum class SimdLevel { kScalar, kSse, kAvx2, kAvx512 };
+
+// Аффинное преобразование: три верхние строки матрицы 4x4, нижняя
+// строка всегда 0 0 0 1. Произведение стоит 36 умножений вместо 64 и
+// вычисляется на этапе компиляции, если множители известны.
+class AffineMatrix {
+ public:
+  using Rows = std::array<std::array<float, 4>, 3>;
+
+  constexpr AffineMatrix()
+      : rows_{{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}}} {}
+  constexpr explicit AffineMatrix(const Rows &rows) : rows_(rows) {}
+
+  constexpr AffineMatrix operator*(const AffineMatrix &other) const {
+    Rows result{};
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 4; ++c) {
+        result[r][c] = rows_[r][0] * other.rows_[0][c] +
+                       rows_[r][1] * other.rows_[1][c] +
+                       rows_[r][2] * other.rows_[2][c];
+      }
+      result[r][3] += rows_[r][3];
+    }
+    return AffineMatrix(result);
+  }
+  constexpr ThreeDPoint TransformPoint(const ThreeDPoint &point) const {
+    return ThreeDPoint(Row(0, point), Row(1, point), Row(2, point));
+  }
+  constexpr float Get(int row, int col) const { return rows_[row][col]; }
+  constexpr const Rows &GetRows() const { return rows_; }
+  // Полная матрица 4x4 по столбцам, как её ждёт glMultMatrixf.
+  constexpr array<float, 16> GetColumnMajor() const {
+    array<float, 16> result{};
+    for (int c = 0; c < 4; ++c) {
+      for (int r = 0; r < 3; ++r) result[c * 4 + r] = rows_[r][c];
+    }
+    result[15] = 1;
+    return result;
+  }
+
+  static constexpr AffineMatrix Translation(float x, float y, float z) {
+    return AffineMatrix(Rows{{{1, 0, 0, x}, {0, 1, 0, y}, {0, 0, 1, z}}});
+  }
+  static constexpr AffineMatrix Scaling(float x, float y, float z) {
+    return AffineMatrix(Rows{{{x, 0, 0, 0}, {0, y, 0, 0}, {0, 0, z, 0}}});
+  }
+  // Перенос * поворот Rz * Ry * Rx * масштаб одной формулой по уже
+  // вычисленным синусам и косинусам углов.
+  static constexpr AffineMatrix FromTrs(const array<float, 3> &move,
+                                        const array<float, 3> &sin,
+                                        const array<float, 3> &cos,
+                                        const array<float, 3> &scale) {
+    float sx = sin[0], sy = sin[1], sz = sin[2];
+    float cx = cos[0], cy = cos[1], cz = cos[2];
+    Rows rotation{{{cz * cy, cz * sy * sx - sz * cx, cz * sy * cx + sz * sx},
+                   {sz * cy, sz * sy * sx + cz * cx, sz * sy * cx - cz * sx},
+                   {-sy, cy * sx, cy * cx}}};
+    Rows result{};
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) result[r][c] = rotation[r][c] * scale[c];
+      result[r][3] = move[r];
+    }
+    return AffineMatrix(result);
+  }
+  // То же по углам в градусах; синус и косинус считаются один раз на ось.
+  static AffineMatrix FromTrs(const array<float, 3> &move,
+                              const array<float, 3> &rotate,
+                              const array<float, 3> &scale);
+  static AffineMatrix Rotation(double x, double y, double z) {
+    return FromTrs({0, 0, 0}, {float(x), float(y), float(z)}, {1, 1, 1});
+  }
+
+  // Преобразует count точек, лежащих подряд как x y z. in и out могут
+  // совпадать, но не перекрываться частично. Ядро выбирается по
+  // процессору; level ограничивает его сверху (для тестов и замеров).
+  // Ядра AVX2 и AVX-512 используют FMA, поэтому их результат может
+  // отличаться от скалярного на 2^-20 суммы модулей слагаемых.
+  void TransformPoints(const float *in, float *out, size_t count) const;
+  void TransformPoints(const float *in, float *out, size_t count,
+                       SimdLevel level) const;
+  // Лучший набор инструкций, поддерживаемый процессором.
+  static SimdLevel GetSimdLevel();
+
+ private:
+  constexpr float Row(int r, const ThreeDPoint &p) const {
+    return rows_[r][0] * p.x + rows_[r][1] * p.y + rows_[r][2] * p.z +
+           rows_[r][3];
+  }
+
+  Rows rows_;
+};
+
+// Полная матрица 4x4 - для проекций; аффинные преобразования модели
+// считаются через AffineMatrix.
 class TransformMatrix {
  public:
   TransformMatrix();
+  explicit TransformMatrix(const AffineMatrix &affine);
   TransformMatrix operator*(const TransformMatrix &other) const;
   ThreeDPoint TransformPoint(const ThreeDPoint &point) const;
 
@@ -79,28 +208,103 @@ class Vertex : public SceneObject {
   ThreeDPoint position_;
 };
 
-class Edge {
+// Ребро - пара номеров вершин фигуры. Ширина номера выбирается по числу
+// вершин: 16 бит для небольших сеток, 32 для обычных, 64 только если
+// иначе не поместится. Массив рёбер можно без преобразований писать в
+// кэш и отдавать в индексный буфер.
+template <typename Index>
+class BasicEdge {
  public:
-  Vertex *GetBegin() const;
-  Vertex *GetEnd() const;
+  using IndexType = Index;
+  BasicEdge() = default;
+  BasicEdge(Index begin, Index end) : begin_(begin), end_(end) {}
+  Index GetBegin() const { return begin_; }
+  Index GetEnd() const { return end_; }
 
-  void setBegin(Vertex *v);
-  void setEnd(Vertex *v);
+  void setBegin(Index v) { begin_ = v; }
+  void setEnd(Index v) { end_ = v; }
+
+  bool operator==(const BasicEdge &other) const;
+  bool operator<(const BasicEdge &other) const;
+  bool operator>(const BasicEdge &other) const;
+
+ private:
+  Index begin_ = 0;
+  Index end_ = 0;
+};
 
-  bool operator==(const Edge &other) const;
-  bool operator<(const Edge &other) const;
-  bool operator>(const Edge &other) const;
+using Edge16 = BasicEdge<uint16_t>;
+using Edge = BasicEdge<uint32_t>;
+using Edge64 = BasicEdge<uint64_t>;
+using EdgeArray = variant<vector<Edge16>, vector<Edge>, vector<Edge64>>;
+// Номера вершин ломаных, разделённых наибольшим значением типа.
+using StripArray =
+    variant<vector<uint16_t>, vector<uint32_t>, vector<uint64_t>>;
+
+// Вызывает f(Index()) с самым узким типом номера, в который помещаются
+// номера вершин [0, vertex_count).
+template <typename F>
+decltype(auto) DispatchIndexWidth(size_t vertex_count, F &&f) {
+  if (vertex_count <= std::numeric_limits<uint16_t>::max() + size_t(1)) {
+    return f(uint16_t());
+  }
+  if (vertex_count <= std::numeric_limits<uint32_t>::max() + size_t(1)) {
+    return f(uint32_t());
+  }
+  return f(uint64_t());
+}
+
+class WorkerPool;
+
+// Часть фигуры: подряд идущие рёбра или вершины и их рамка в координатах
+// хранения (до GetModelMatrix).
+struct Cluster {
+  IndexRange range;
+  NormalizationParameters bounds;
+};
+
+// Пирамида видимости: шесть плоскостей a*x + b*y + c*z + d >= 0,
+// извлечённых из произведения матриц проекции и вида (по столбцам, как
+// их отдаёт glGetFloatv).
+class Frustum {
+ public:
+  Frustum(const array<float, 16> &projection, const array<float, 16> &view);
+  // Та же пирамида в координатах до преобразования model, так что рамки
+  // проверяются без пересчёта вершин.
+  Frustum Transformed(const AffineMatrix &model) const;
+  // false, только если рамка целиком снаружи одной из плоскостей;
+  // изредка пропускает рамки у рёбер пирамиды, что для отсечения
+  // безопасно.
+  bool Intersects(const NormalizationParameters &box) const;
 
  private:
-  Vertex *begin_;
-  Vertex *end_;
+  Frustum() = default;
+  array<array<float, 4>, 6> planes_;
 };
 
+// Произведение a * b матриц 4x4, хранящихся по столбцам.
+array<float, 16> MultiplyColumnMajor(const array<float, 16> &a,
+                                     const array<float, 16> &b);
+
+class Figure;
+
+// Упрощённая копия фигуры: вершины стянуты в ячейки кубической сетки со
+// стороной cellSize (в координатах хранения), рёбра внутри ячейки
+// выброшены, а совпавшие - слиты.
+struct LodLevel {
+  std::shared_ptr<Figure> figure;
+  float cellSize;
+};
+
+// Кластеры, пересекающие frustum, как диапазоны их элементов; соседние
+// видимые кластеры сливаются в один диапазон. Кластеры проверяются
+// блоками параллельно в pool.
+void CullClusters(std::span<const Cluster> clusters, const Frustum &frustum,
+                  vector<IndexRange> &visible, WorkerPool &pool);
+
 class Figure : public SceneObject {
  public:
   Figure() {
-    vertices_.reserve(1000000);
-    dataVertices_.reserve(1000000);
     rotate_[0] = 0;
     rotate_[1] = 0;
     rotate_[2] = 0;
@@ -111,36 +315,199 @@ class Figure : public SceneObject {
     scale_[1] = 1;
     scale_[2] = 1;
   }
-  vector<shared_ptr<Vertex>> GetVertices();
-  vector<Edge> GetEdges();
+  // Позиции лежат подряд как x0 y0 z0 x1 y1 z1 ... такими, какими их
+  // дала загрузка (после нормализации), либо, после Quantize, 16-битными
+  // целыми. Поза фигуры их не меняет: она передаётся при отрисовке
+  // матрицей GetModelMatrix.
+  size_t GetVertexCount() const {
+    return (positions_.size() + quantized_.size()) / 3;
+  }
+  // Вершина с применённой позой.
+  ThreeDPoint GetVertex(size_t index) const;
+  // Вершина до применения позы (для квантованной - восстановленная).
+  ThreeDPoint GetDataVertex(size_t index) const;
+  // Пуст у квантованной фигуры.
+  const vector<float> &GetPositions() const { return positions_; }
+  bool IsQuantized() const { return !quantized_.empty(); }
+  // f получает span<const float> или span<const int16_t> - хранимые
+  // позиции, к которым применяется GetModelMatrix.
+  template <typename F>
+  decltype(auto) VisitPositions(F &&f) const {
+    if (IsQuantized()) return f(std::span<const int16_t>(quantized_));
+    return f(std::span<const float>(positions_));
+  }
+  // Заменяет позиции целыми от -32767 до 32767 внутри рамки bounds,
+  // которая должна содержать все вершины, и освобождает float-массив.
+  // Обратное преобразование входит в GetModelMatrix, так что вершины
+  // восстанавливаются при отрисовке. Возвращает наибольшее отклонение
+  // восстановленной координаты от исходной (не больше половины шага
+  // сетки, размер рамки / 65534).
+  float Quantize(const NormalizationParameters &bounds);
+  size_t GetEdgeCount() const;
+  Edge64 GetEdge(size_t index) const;
+  // Размер номера вершины в рёбрах, байт: 2, 4 или 8.
+  size_t GetIndexSize() const;
+  // f получает span<const BasicEdge<Index>> текущей ширины, так что
+  // циклы по рёбрам компилируются отдельно для каждой ширины.
+  template <typename F>
+  decltype(auto) VisitEdges(F &&f) const {
+    return std::visit(
+        [&f](const auto &edges) {
+          return f(std::span<const typename std::decay_t<
+                       decltype(edges)>::value_type>(edges));
+        },
+        edges_);
+  }
+  // Переставляет вершины вдоль кривой Мортона (номера в рёбрах меняются
+  // соответственно), рёбра - по меньшему номеру вершины, и делит те и
+  // другие на пространственно связные кластеры по cluster_size с
+  // рамками, чтобы отрисовка пропускала кластеры вне экрана. Вызывается
+  // после Quantize; любое изменение геометрии кластеры сбрасывает.
+  void BuildClusters(size_t cluster_size = kClusterSize);
+  std::span<const Cluster> GetEdgeClusters() const { return edgeClusters_; }
+  std::span<const Cluster> GetVertexClusters() const {
+    return vertexClusters_;
+  }
+  static constexpr size_t kClusterSize = 4096;
+  // Строит уровни детализации всё грубее, стягивая вершины в ячейки
+  // сетки, которая на каждом уровне вдвое крупнее; уровень остаётся,
+  // только если рёбер в нём хотя бы вдвое меньше, чем в предыдущем.
+  // Фигуры меньше kLodMinEdges рёбер не упрощаются. Вызывается после
+  // BuildClusters, который переставляет вершины; любое изменение
+  // геометрии уровни сбрасывает.
+  void BuildLods();
+  // От подробного к грубому. Позиции уровней хранятся так же, как у
+  // фигуры (в том числе квантованными), и рисуются с её GetModelMatrix.
+  std::span<const LodLevel> GetLods() const { return lods_; }
+  // Уровень для кадра: 0 - сама фигура, i - GetLods()[i - 1]. Берётся
+  // самый грубый, чья ячейка на экране не больше kLodPixels пикселей
+  // области width x height; current - уровень прошлого кадра, от
+  // которого выбор отходит, только когда ошибка выходит за порог с
+  // запасом kLodHysteresis, так что масштаб у границы не мерцает.
+  size_t SelectLod(const array<float, 16> &projection,
+                   const array<float, 16> &view, float width, float height,
+                   size_t current) const;
+  static constexpr size_t kLodMinEdges = 65536;
+  static constexpr float kLodPixels = 1;
+  static constexpr float kLodHysteresis = 1.25f;
+  // Сцепляет рёбра в ломаные, чтобы общая вершина соседних рёбер
+  // передавалась при отрисовке один раз. Ломаные идут подряд и
+  // разделены наибольшим значением типа номера, как того ждёт
+  // GL_PRIMITIVE_RESTART_FIXED_INDEX; тип выбирается так, чтобы это
+  // значение не было номером вершины. Рёбра остаются как были, а ломаные
+  // сбрасываются при любом их изменении.
+  void BuildStrips();
+  bool HasStrips() const {
+    return std::visit([](const auto &strips) { return !strips.empty(); },
+                      strips_);
+  }
+  // f получает span<const Index> номеров ломаных.
+  template <typename F>
+  decltype(auto) VisitStrips(F &&f) const {
+    return std::visit(
+        [&f](const auto &strips) {
+          return f(std::span<const typename std::decay_t<
+                       decltype(strips)>::value_type>(strips));
+        },
+        strips_);
+  }
+  // Пересчитывает матрицу модели по параметрам позы; вершины не
+  // затрагиваются, так что стоимость не зависит от размера фигуры.
   void Transform();
-  void setEdges(const Edge &edge);
-  void setVertices(const shared_ptr<Vertex> &vertex);
-  void setDataVertices(const Vertex &vertex);
+  // true, если параметры позы менялись после последнего Transform.
+  bool IsTransformDirty() const { return transformDirty_; }
+  // Переводит хранимые позиции в мировые: поза, умноженная на
+  // восстановление квантованных координат.
+  const AffineMatrix &GetModelMatrix() const { return modelMatrix_; }
+  MemoryUsage GetMemoryUsage() const;
+  // Квантованная фигура сначала возвращается к float.
+  void AddVertex(const ThreeDPoint &position);
+  // Расширяет номера рёбер, если begin или end не помещаются.
+  void AddEdge(uint64_t begin, uint64_t end);
+  // Заменяют массивы целиком.
+  void setPositions(vector<float> positions);
+  template <typename Index>
+  void setEdges(vector<BasicEdge<Index>> edges) {
+    edges_ = std::move(edges);
+    MarkEdgesDirty(0, GetEdgeCount());
+  }
+  // Растёт при каждом изменении позиций или рёбер (но не позы): по нему
+  // отрисовщик узнаёт, что загруженные в GL буферы устарели.
+  uint64_t GetGeometryVersion() const { return geometryVersion_; }
+  // Вершины и рёбра, изменённые после версии GetDirtyBaseVersion.
+  // Потребитель, у которого загружена именно эта версия, может
+  // перечитать только их; загрузивший более раннюю перечитывает всё.
+  // Замена массива или смена их типа помечает массив целиком.
+  IndexRange GetDirtyVertices() const { return dirtyVertices_; }
+  IndexRange GetDirtyEdges() const { return dirtyEdges_; }
+  uint64_t GetDirtyBaseVersion() const { return dirtyBaseVersion_; }
+  // Вызывается потребителем после того, как он перечитал изменения.
+  void ClearDirtyRanges();
   void setRotate(float x, float y, float z);
   void setMove(float x, float y, float z);
   void setScale(float x);
-  vector<Edge> GetEdges() const { return edges_; }
-  vector<shared_ptr<Vertex>> GetVertices() const { return vertices_; }
-  vector<Vertex> GetDataVertices() const { return dataVertices_; }
 
  private:
-  vector<shared_ptr<Vertex>> vertices_;
-  vector<Vertex> dataVertices_;
-  vector<Edge> edges_;
+  ThreeDPoint GetStoredVertex(size_t index) const;
+  // Все ли номера в рёбрах меньше числа вершин: AddEdge этого не
+  // проверяет.
+  bool HasValidEdges() const;
+  void Dequantize();
+  void MarkVerticesDirty(size_t first, size_t last);
+  void MarkEdgesDirty(size_t first, size_t last);
 
- public:
+  vector<float> positions_;
+  vector<int16_t> quantized_;
+  // хранимые координаты -> исходные; единичная без квантования
+  AffineMatrix dequantize_;
+  EdgeArray edges_;
+  StripArray strips_;
+  vector<Cluster> edgeClusters_;
+  vector<Cluster> vertexClusters_;
+  vector<LodLevel> lods_;
+  // центр рамки фигуры в координатах хранения, где оценивается масштаб
+  ThreeDPoint lodCenter_{0, 0, 0};
   array<float, 3> rotate_;
   array<float, 3> move_;
   array<float, 3> scale_;
+  AffineMatrix modelMatrix_;
+  bool transformDirty_ = false;
+  uint64_t geometryVersion_ = 0;
+  uint64_t dirtyBaseVersion_ = 0;
+  IndexRange dirtyVertices_;
+  IndexRange dirtyEdges_;
 };
 
+// Сцена только перемещается: загруженная геометрия передаётся от читателя
+// к фасаду и виду без копий, а вид разделяет владение через
+// shared_ptr<const Scene>.
 class Scene {
  public:
-  const std::vector<std::shared_ptr<Figure>> &GetFigures() const {
+  Scene() = default;
+  Scene(const Scene &) = delete;
+  Scene &operator=(const Scene &) = delete;
+  Scene(Scene &&) = default;
+  Scene &operator=(Scene &&) = default;
+
+  // Вид на фигуры без копирования указателей и счётчиков ссылок.
+  std::span<const std::shared_ptr<Figure>> GetFigures() const {
     return figures_;
   }
   void TransformFigures(TransformMatrix);
+  // Figure::Transform для фигур с IsTransformDirty. Возвращает false,
+  // если пересчитывать было нечего.
+  bool Transform();
+  MemoryUsage GetMemoryUsage() const;
+  // Figure::BuildStrips, Figure::BuildClusters и Figure::BuildLods для
+  // всех фигур.
+  void BuildStrips();
+  void BuildClusters();
+  void BuildLods();
+  // Figure::Quantize для всех фигур по общей рамке сцены, так что
+  // вершины, повторённые в соседних фигурах, квантуются одинаково.
+  // Возвращает наибольшую ошибку.
+  float Quantize();
+  float GetQuantizationError() const { return quantizationError_; }
 
   void setFigures(const std::shared_ptr<Figure> &figure) {
     figures_.push_back(figure);
@@ -148,13 +515,116 @@ class Scene {
 
  private:
   std::vector<std::shared_ptr<Figure>> figures_;
+  float quantizationError_ = 0;
+};
+
+struct LoadProgress {
+  size_t bytes_read;
+  size_t total_bytes;
+  size_t records_parsed;
+};
+
+// Токен отмены загрузки: читатель периодически проверяет его и при отмене
+// возвращает пустую сцену.
+using CancellationToken = shared_ptr<const atomic<bool>>;
+using ProgressCallback = function<void(const LoadProgress &)>;
+
+// Часть геометрии, прочитанная с момента предыдущей публикации: новые
+// вершины (ещё не центрированные) и новые рёбра в сквозной нумерации
+// вершин всех фигур по порядку.
+struct GeometryBatch {
+  size_t first_vertex = 0;
+  vector<float> positions;
+  vector<uint32_t> edges;
 };
+using BatchCallback = function<void(shared_ptr<GeometryBatch>)>;
+
+class SceneBuilder;
 
 class BaseFileReader {
  public:
   virtual Scene ReadScene(string path,
                           NormalizationParameters normalization_parameters) = 0;
   virtual ~BaseFileReader() = default;
+
+  // Шаг в байтах, с которым читатели проверяют отмену и сообщают прогресс.
+  static constexpr size_t kProgressStep = 1 << 20;
+
+  // Колбэк может вызываться из рабочих потоков читателя.
+  virtual void setProgressCallback(ProgressCallback callback) {
+    progress_ = std::move(callback);
+  }
+  virtual void setCancellationToken(CancellationToken token) {
+    cancel_ = std::move(token);
+  }
+  // Потоковый режим: читатель публикует растущую геометрию не чаще, чем
+  // раз в interval; параллельный читатель - по кускам файла.
+  virtual void setBatchCallback(
+      BatchCallback callback,
+      std::chrono::milliseconds interval = std::chrono::milliseconds(100)) {
+    batch_ = std::move(callback);
+    batchInterval_ = interval;
+  }
+
+ protected:
+  bool IsCancelled() const {
+    return cancel_ && cancel_->load(std::memory_order_relaxed);
+  }
+  void ReportProgress(size_t bytes_read, size_t total_bytes,
+                      size_t records_parsed) const {
+    if (progress_) progress_({bytes_read, total_bytes, records_parsed});
+  }
+  bool IsStreaming() const { return static_cast<bool>(batch_); }
+  // Публикует накопленное в builder, если прошло batchInterval_ или
+  // force == true.
+  void PublishBatch(SceneBuilder &builder, bool force = false);
+  // Сколько вершин и рёбер уже опубликовано читателем, который пишет
+  // фигуру сам, без SceneBuilder.
+  struct BatchCursor {
+    size_t vertices = 0;
+    size_t edges = 0;
+  };
+  // То же для такого читателя: positions и edges - всё, что прочитано
+  // к этому моменту, публикуется добавленное после cursor. Ребро -
+  // BasicEdge или ключ EdgeIndexSet.
+  template <typename EdgeType>
+  void PublishBatch(std::span<const float> positions,
+                    std::span<const EdgeType> edges, BatchCursor &cursor,
+                    bool force = false) {
+    if (!IsBatchDue(force)) return;
+    auto batch = make_shared<GeometryBatch>();
+    batch->first_vertex = cursor.vertices;
+    batch->positions.assign(positions.begin() + cursor.vertices * 3,
+                            positions.end());
+    batch->edges.reserve((edges.size() - cursor.edges) * 2);
+    for (const EdgeType &edge : edges.subspan(cursor.edges)) {
+      if constexpr (std::is_same_v<EdgeType, uint64_t>) {
+        batch->edges.push_back(edge >> 32);
+        batch->edges.push_back(edge & 0xFFFFFFFFu);
+      } else {
+        batch->edges.push_back(edge.GetBegin());
+        batch->edges.push_back(edge.GetEnd());
+      }
+    }
+    cursor = {positions.size() / 3, edges.size()};
+    if (!batch->positions.empty() || !batch->edges.empty()) {
+      SendBatch(std::move(batch));
+    }
+  }
+  // Сцена из одной фигуры, центрированной по своей рамке так же, как
+  // центрирует SceneBuilder::Build; пустая, если вершин нет.
+  static Scene MakeScene(vector<float> positions, EdgeArray edges);
+  // Публикует готовую часть сразу, без проверки интервала.
+  void SendBatch(shared_ptr<GeometryBatch> batch);
+
+ private:
+  bool IsBatchDue(bool force) const;
+
+  ProgressCallback progress_;
+  CancellationToken cancel_;
+  BatchCallback batch_;
+  std::chrono::milliseconds batchInterval_{100};
+  std::chrono::steady_clock::time_point lastBatch_;
 };
 
 class FileReader : public BaseFileReader {
@@ -163,6 +633,309 @@ class FileReader : public BaseFileReader {
                   NormalizationParameters normalization_parameters);
 };
 
+// Множество рёбер, заданных парой индексов вершин. Ключ - упакованная
+// пара (меньший, больший), хранится в хеш-таблице с открытой адресацией;
+// порядок ключей в GetKeys() совпадает с порядком первой вставки.
+class EdgeIndexSet {
+ public:
+  EdgeIndexSet();
+  static uint64_t MakeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+  }
+  bool Insert(uint32_t a, uint32_t b);
+  void Reserve(size_t count);
+  size_t GetSize() const { return keys_.size(); }
+  const vector<uint64_t> &GetKeys() const { return keys_; }
+  // Рёбра в порядке GetKeys() с самым узким типом номера для
+  // vertex_count вершин.
+  EdgeArray ToEdgeArray(size_t vertex_count) const;
+
+ private:
+  static constexpr uint64_t kEmpty = ~uint64_t(0);
+  void Rehash(size_t capacity);
+
+  vector<uint64_t> slots_;
+  vector<uint64_t> keys_;
+  unsigned shift_;
+};
+
+// Собирает фигуру из вершин и граней в порядке их появления в файле,
+// общая часть всех читателей OBJ.
+class SceneBuilder {
+ public:
+  SceneBuilder();
+  void Reserve(size_t vertex_count, size_t face_count);
+  // Записи o и g начинают новую фигуру; пустая текущая фигура
+  // используется повторно.
+  void BeginFigure();
+  // Вершина принадлежит фигуре, в которой объявлена.
+  void AddVertex(double x, double y, double z);
+  // numbers - номера вершин грани в нумерации OBJ (с единицы). Вершины
+  // других фигур копируются в текущую, у каждой фигуры свои массивы.
+  // У фигуры без рёбер отбрасываются вершины, скопированные в другие,
+  // а оставшаяся без вершин не попадает в сцену: файл, где все v идут
+  // до групп, не даёт лишней фигуры из одних точек.
+  void AddFace(const vector<int> &numbers);
+  // vertex_limit - сколько вершин было объявлено к моменту грани
+  void AddFace(const int *numbers, size_t count, size_t vertex_limit);
+  size_t GetVertexCount() const { return owners_.size(); }
+  // Заполняет batch вершинами и рёбрами, добавленными после прошлого
+  // вызова; false, если нового ничего нет.
+  bool TakeBatch(GeometryBatch &batch);
+  Scene Build();
+
+ private:
+  struct FigureData {
+    // x y z подряд, ещё не центрированные
+    vector<float> positions;
+    EdgeIndexSet edges;
+    // сквозной номер первой вершины фигуры в частях GeometryBatch
+    size_t first_vertex = 0;
+  };
+  uint32_t LocalIndex(uint32_t vertex);
+  void DropCopiedPoints();
+
+  NormalizationParameters params_;
+  vector<FigureData> figures_;
+  // фигура и номер в ней для каждой вершины OBJ
+  vector<pair<uint32_t, uint32_t>> owners_;
+  // вершина скопирована хотя бы в одну другую фигуру
+  vector<bool> copied_;
+  // вершины других фигур, скопированные в текущую
+  unordered_map<uint32_t, uint32_t> borrowed_;
+  vector<int> indices_;
+  size_t batchFigure_ = 0;
+  size_t batchVertices_ = 0;
+  size_t batchEdges_ = 0;
+};
+
+// Значение T из невыровненного буфера с порядком байт order.
+template <typename T>
+T LoadUnaligned(const char *p, std::endian order = std::endian::little) {
+  T value;
+  if (order == std::endian::native) {
+    memcpy(&value, p, sizeof(T));
+  } else {
+    char bytes[sizeof(T)];
+    std::reverse_copy(p, p + sizeof(T), bytes);
+    memcpy(&value, bytes, sizeof(T));
+  }
+  return value;
+}
+
+// Файл, отображённый в память только для чтения.
+class MappedFile {
+ public:
+  explicit MappedFile(const string &path);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool IsOpen() const { return data_ != nullptr; }
+  const char *GetData() const { return data_; }
+  size_t GetSize() const { return size_; }
+
+ private:
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Разбор записей v и f без копирования строки. begin указывает на символ
+// после буквы записи, end - на конец строки.
+class ObjRecordParser {
+ public:
+  static bool ParseVertex(const char *begin, const char *end,
+                          array<double, 3> &vertex);
+  static void ParseFace(const char *begin, const char *end,
+                        vector<int> &numbers);
+  // Записи o и g (объект и группа) начинают новую фигуру.
+  static bool IsGroup(const char *line, const char *eol);
+  // Разбирает строку [line, eol) и добавляет запись v или f в builder;
+  // возвращает true, если строка была такой записью.
+  static bool ParseLine(const char *line, const char *eol,
+                        SceneBuilder &builder, vector<int> &numbers);
+  // Быстрый подсчёт записей v и f для резервирования памяти.
+  static void CountRecords(const char *begin, const char *end,
+                           size_t &vertex_count, size_t &face_count);
+};
+
+// Читатель OBJ через mmap: строит ту же сцену, что и FileReader.
+class MappedFileReader : public BaseFileReader {
+ public:
+  Scene ReadScene(string path,
+                  NormalizationParameters normalization_parameters) override;
+};
+
+// Параллельный читатель OBJ: файл делится на куски по границам строк,
+// куски разбираются в отдельных потоках, затем индексы граней
+// согласуются через префиксные суммы числа вершин. Слияние тоже
+// параллельно: рёбра делятся по хешу между потоками, каждый оставляет
+// первые вхождения своих рёбер, и они собираются в порядке файла.
+// Если грань ссылается на вершину другой фигуры (o/g), куски сливаются
+// последовательно через SceneBuilder. В потоковом режиме кусок
+// публикуется целиком, как только разобраны все предыдущие.
+class ParallelFileReader : public MappedFileReader {
+ public:
+  explicit ParallelFileReader(unsigned threads = 0,
+                              size_t min_chunk_size = 1 << 20);
+  Scene ReadScene(string path,
+                  NormalizationParameters normalization_parameters) override;
+
+ private:
+  unsigned threads_;
+  size_t min_chunk_size_;
+};
+
+// Потоковый читатель OBJ для файлов .obj.gz и стандартного ввода ("-").
+// Распаковка (zlib, несжатые данные читаются как есть) идёт в отдельном
+// потоке и передаётся разбору через ограниченное кольцо блоков, так что
+// время загрузки стремится к max(распаковка, разбор). Источник ждётся
+// через poll с таймаутом, поэтому отмена срабатывает и на канале, в
+// который ничего не пишут. Повреждённый или обрезанный gzip и ошибка
+// чтения дают пустую сцену.
+class StreamFileReader : public BaseFileReader {
+ public:
+  explicit StreamFileReader(size_t block_size = 1 << 20,
+                            size_t block_count = 4);
+  Scene ReadScene(string path,
+                  NormalizationParameters normalization_parameters) override;
+
+ private:
+  size_t block_size_;
+  size_t block_count_;
+};
+
+// Двоичный и текстовый STL. Треугольники хранят вершины независимо,
+// поэтому совпадающие побитово позиции сливаются в одну вершину.
+// Двоичный файл, размер которого не равен 84 + 50 * число треугольников
+// из заголовка, не читается (пустая сцена). Фигура собирается прямо в
+// массивы позиций и рёбер, без SceneBuilder.
+class StlFileReader : public BaseFileReader {
+ public:
+  // weld == false: вершины двоичного файла копируются блоком как есть,
+  // без хеширования. Вершин втрое больше треугольников, общие рёбра
+  // соседних треугольников повторяются.
+  explicit StlFileReader(bool weld = true) : weld_(weld) {}
+  Scene ReadScene(string path,
+                  NormalizationParameters normalization_parameters) override;
+
+ private:
+  Scene ReadBinary(const MappedFile &file);
+  Scene ReadBinaryUnwelded(const MappedFile &file);
+  Scene ReadAscii(const MappedFile &file);
+
+  bool weld_;
+};
+
+// Двоичный PLY (little и big endian). Берутся свойства x, y, z элемента
+// vertex и список vertex_indices (vertex_index) элемента face, остальные
+// элементы и свойства пропускаются. Позиции пишутся прямо в массив
+// фигуры, а если у вершины только x, y, z типа float в порядке байт
+// машины - копируются блоком.
+class PlyFileReader : public BaseFileReader {
+ public:
+  // merge_edges == false: рёбра граней пишутся как есть, без хеширования,
+  // и общее ребро двух граней повторяется. Сливаются рёбра только при
+  // числе вершин до 2^32.
+  explicit PlyFileReader(bool merge_edges = true)
+      : mergeEdges_(merge_edges) {}
+  Scene ReadScene(string path,
+                  NormalizationParameters normalization_parameters) override;
+
+ private:
+  bool mergeEdges_;
+};
+
+enum class FileFormat { kObj, kObjStream, kStl, kPly };
+
+// Формат по сигнатуре файла, а если она не распознана - по расширению.
+// "-" (стандартный ввод) и gzip читаются StreamFileReader.
+FileFormat DetectFileFormat(const string &path);
+
+// Двоичный кэш сцены поверх другого читателя. После первой загрузки
+// нормализованные вершины и индексы рёбер пишутся рядом с исходным файлом
+// (или в cache_dir), повторная загрузка неизменённого файла строит фигуры
+// из отображённого в память кэша без разбора текста. Фигура владеет
+// своими массивами, поэтому позиции и рёбра копируются из отображения:
+// выделения памяти те же, что при разборе. Кэш считается устаревшим,
+// если не совпадает размер, время изменения или хеш содержимого
+// исходника; хеш считается один раз за загрузку.
+class CachedFileReader : public BaseFileReader {
+ public:
+  static constexpr uint32_t kVersion = 2;
+
+  explicit CachedFileReader(unique_ptr<BaseFileReader> reader,
+                            string cache_dir = "");
+  Scene ReadScene(string path,
+                  NormalizationParameters normalization_parameters) override;
+  void setProgressCallback(ProgressCallback callback) override;
+  void setCancellationToken(CancellationToken token) override;
+  void setBatchCallback(BatchCallback callback,
+                        std::chrono::milliseconds interval =
+                            std::chrono::milliseconds(100)) override;
+  string GetCachePath(const string &path) const;
+  static uint64_t HashContent(const char *data, size_t size);
+
+ private:
+  // Размер, время изменения и хеш исходника, с которыми сверяется кэш.
+  struct SourceStamp {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+  };
+  bool ReadCache(const string &cache_path, const SourceStamp &source,
+                 Scene &scene) const;
+  void WriteCache(const string &cache_path, const SourceStamp &source,
+                  const Scene &scene) const;
+
+  unique_ptr<BaseFileReader> reader_;
+  string cache_dir_;
+};
+
+// Постоянный пул потоков для параллельных циклов. Потоки создаются один
+// раз и спят между задачами, так что короткие циклы не платят за запуск.
+class WorkerPool {
+ public:
+  // threads - число потоков вместе с вызывающим, 0 - по числу ядер.
+  explicit WorkerPool(unsigned threads = 0);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  unsigned GetThreadCount() const { return workers_.size() + 1; }
+  // Вызывает body(i) для всех i из [0, count) в потоках пула и в
+  // вызывающем потоке и возвращает управление после последнего вызова.
+  // Вложенные вызовы из body выполняются последовательно. body не
+  // копируется, так что вызов ничего не выделяет, сколько бы body ни
+  // захватывал.
+  template <typename F>
+  void ParallelFor(size_t count, const F &body) {
+    Run(count, &body, [](const void *context, size_t i) {
+      (*static_cast<const F *>(context))(i);
+    });
+  }
+  static WorkerPool &Shared();
+
+ private:
+  using Body = void (*)(const void *context, size_t i);
+  void Run(size_t count, const void *context, Body body);
+  void RunJob();
+  void WorkerLoop();
+
+  vector<std::thread> workers_;
+  std::mutex runMutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const void *context_ = nullptr;
+  Body body_ = nullptr;
+  size_t count_ = 0;
+  atomic<size_t> next_{0};
+  size_t active_ = 0;
+  size_t generation_ = 0;
+  bool stop_ = false;
+};
+
 class TransformMatrixBuilder {
  public:
   static TransformMatrix CreateRotationMatrix(double x, double y, double z);
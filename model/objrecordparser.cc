@@ -0,0 +1,131 @@
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+#include "model.h"
+using namespace viewer;
+
+namespace {
+// Те же пробельные символы, что пропускает operator>> у istream.
+inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' ||
+         c == '\f';
+}
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline const char *SkipSpaces(const char *p, const char *end) {
+  while (p < end && IsSpace(*p)) ++p;
+  return p;
+}
+
+// Ведёт себя как iss >> value: '+' допустим, inf/nan и hex - нет.
+bool ParseDouble(const char *&p, const char *end, double &value) {
+  p = SkipSpaces(p, end);
+  const char *start = p;
+  if (start < end && *start == '+') ++start;
+  const char *digits = start;
+  if (digits < end && *digits == '-' && start == p) ++digits;
+  if (digits >= end || !(IsDigit(*digits) || *digits == '.')) return false;
+
+  auto [ptr, ec] = std::from_chars(start, end, value);
+  if (ec == std::errc::result_out_of_range) {
+    // istream принимает исчезающе малые числа и отвергает переполнение.
+    string token(start, ptr);
+    value = strtod(token.c_str(), nullptr);
+    if (std::isinf(value)) return false;
+  } else if (ec != std::errc()) {
+    return false;
+  }
+  p = ptr;
+  return true;
+}
+
+bool ParseInt(const char *&p, const char *end, int &value) {
+  const char *start = p;
+  if (start < end && *start == '+') ++start;
+  const char *digits = start;
+  if (digits < end && *digits == '-' && start == p) ++digits;
+  if (digits >= end || !IsDigit(*digits)) return false;
+
+  auto [ptr, ec] = std::from_chars(start, end, value);
+  if (ec != std::errc()) return false;
+  p = ptr;
+  return true;
+}
+
+// Как в FileReader: всё от '/' до ближайшего пробела не учитывается.
+inline const char *SkipSlashRun(const char *p, const char *end) {
+  while (p < end && *p != ' ') ++p;
+  return p;
+}
+}  // namespace
+
+bool ObjRecordParser::ParseVertex(const char *begin, const char *end,
+                                  array<double, 3> &vertex) {
+  const char *p = begin;
+  for (int i = 0; i < 3; ++i) {
+    if (!ParseDouble(p, end, vertex[i])) return false;
+  }
+  return true;
+}
+
+void ObjRecordParser::ParseFace(const char *begin, const char *end,
+                                vector<int> &numbers) {
+  numbers.clear();
+  const char *p = begin;
+  while (true) {
+    p = SkipSpaces(p, end);
+    if (p < end && *p == '/') {
+      p = SkipSlashRun(p, end);
+      continue;
+    }
+    int number;
+    if (!ParseInt(p, end, number)) break;
+    numbers.push_back(number);
+    if (p < end && *p == '/') p = SkipSlashRun(p, end);
+  }
+}
+
+bool ObjRecordParser::IsGroup(const char *line, const char *eol) {
+  return eol > line && (line[0] == 'o' || line[0] == 'g') &&
+         (eol - line == 1 || line[1] == ' ' || line[1] == '\r');
+}
+
+bool ObjRecordParser::ParseLine(const char *line, const char *eol,
+                                SceneBuilder &builder, vector<int> &numbers) {
+  if (IsGroup(line, eol)) {
+    builder.BeginFigure();
+    return false;
+  }
+  if (eol - line < 2 || line[1] != ' ') return false;
+  if (line[0] == 'v') {
+    array<double, 3> ver;
+    if (ParseVertex(line + 1, eol, ver)) {
+      builder.AddVertex(ver[0], ver[1], ver[2]);
+    }
+    return true;
+  }
+  if (line[0] == 'f') {
+    ParseFace(line + 1, eol, numbers);
+    builder.AddFace(numbers);
+    return true;
+  }
+  return false;
+}
+
+void ObjRecordParser::CountRecords(const char *begin, const char *end,
+                                   size_t &vertex_count, size_t &face_count) {
+  vertex_count = 0;
+  face_count = 0;
+  const char *p = begin;
+  while (p < end) {
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (!eol) eol = end;
+    if (eol - p > 1 && p[1] == ' ') {
+      vertex_count += p[0] == 'v';
+      face_count += p[0] == 'f';
+    }
+    p = eol + 1;
+  }
+}
@@ -0,0 +1,416 @@
+#include <cstring>
+
+#include "model.h"
+using namespace viewer;
+
+namespace {
+struct ObjChunk {
+  size_t vertex_count = 0;
+  size_t face_count = 0;
+  vector<float> vertices;
+  vector<int> numbers;
+  // для каждой грани: конец её номеров в numbers и число вершин куска,
+  // объявленных до неё
+  vector<size_t> face_ends;
+  vector<size_t> face_vertex_counts;
+  // для каждой записи o/g: число вершин и граней куска до неё
+  vector<pair<size_t, size_t>> group_starts;
+
+  // Для параллельного слияния. Рёбра граней в порядке файла как ключи
+  // EdgeIndexSet в сквозной нумерации вершин, отрезки ключей, идущие в
+  // одну фигуру (фигура, начало), номера ключей по частям хеша и
+  // отметки первых вхождений.
+  size_t vertex_offset = 0;
+  size_t first_figure = 0;
+  vector<uint64_t> keys;
+  vector<pair<size_t, size_t>> runs;
+  vector<vector<uint32_t>> shards;
+  vector<uint8_t> first_seen;
+};
+
+// tick получает приращения байт и записей с последнего вызова и
+// возвращает false, если загрузку отменили.
+using ChunkTick = function<bool(size_t bytes, size_t records)>;
+
+void ParseChunk(const char *p, const char *end, ObjChunk &chunk,
+                const ChunkTick &tick) {
+  ObjRecordParser::CountRecords(p, end, chunk.vertex_count, chunk.face_count);
+  chunk.vertices.reserve(chunk.vertex_count * 3);
+  chunk.numbers.reserve(chunk.face_count * 4);
+  chunk.face_ends.reserve(chunk.face_count);
+  chunk.face_vertex_counts.reserve(chunk.face_count);
+
+  array<double, 3> ver;
+  vector<int> numbers;
+  numbers.reserve(5);
+  const char *last_tick = p;
+  size_t records = 0;
+  while (p < end) {
+    if (size_t(p - last_tick) >= BaseFileReader::kProgressStep) {
+      if (!tick(p - last_tick, records)) return;
+      last_tick = p;
+      records = 0;
+    }
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (!eol) eol = end;
+    if (ObjRecordParser::IsGroup(p, eol)) {
+      chunk.group_starts.emplace_back(chunk.vertices.size() / 3,
+                                      chunk.face_ends.size());
+    } else if (eol - p > 1 && p[1] == ' ') {
+      if (p[0] == 'v') {
+        if (ObjRecordParser::ParseVertex(p + 1, eol, ver)) {
+          chunk.vertices.push_back(ver[0]);
+          chunk.vertices.push_back(ver[1]);
+          chunk.vertices.push_back(ver[2]);
+        }
+        ++records;
+      } else if (p[0] == 'f') {
+        ObjRecordParser::ParseFace(p + 1, eol, numbers);
+        chunk.numbers.insert(chunk.numbers.end(), numbers.begin(),
+                             numbers.end());
+        chunk.face_ends.push_back(chunk.numbers.size());
+        chunk.face_vertex_counts.push_back(chunk.vertices.size() / 3);
+        ++records;
+      }
+    }
+    p = eol + 1;
+  }
+  tick(end - last_tick, records);
+}
+
+// Часть для потокового режима: вершины куска и стороны его граней в
+// сквозной нумерации. Общие стороны соседних граней не сливаются:
+// предпросмотру повторы не мешают, а рёбра сцены сливаются позже.
+shared_ptr<GeometryBatch> MakeChunkBatch(const ObjChunk &chunk,
+                                         size_t vertex_offset) {
+  auto batch = make_shared<GeometryBatch>();
+  batch->first_vertex = vertex_offset;
+  batch->positions = chunk.vertices;
+  batch->edges.reserve(chunk.numbers.size() * 2);
+  size_t begin = 0;
+  vector<uint32_t> indices;
+  indices.reserve(5);
+  for (size_t f = 0; f < chunk.face_ends.size(); ++f) {
+    size_t limit = std::min<size_t>(
+        vertex_offset + chunk.face_vertex_counts[f],
+        size_t(std::numeric_limits<uint32_t>::max()) + 1);
+    indices.clear();
+    for (size_t n = begin; n < chunk.face_ends[f]; ++n) {
+      int idx = chunk.numbers[n] - 1;
+      if (idx >= 0 && size_t(idx) < limit) indices.push_back(idx);
+    }
+    begin = chunk.face_ends[f];
+    // у грани из двух вершин одно ребро
+    size_t sides = indices.size() == 2 ? 1 : indices.size();
+    for (size_t i = 0; indices.size() >= 2 && i < sides; ++i) {
+      batch->edges.push_back(indices[i]);
+      batch->edges.push_back(indices[(i + 1) % indices.size()]);
+    }
+  }
+  return batch;
+}
+
+// Последовательное слияние через SceneBuilder: грань видит вершины всех
+// предыдущих кусков и уже разобранные вершины своего куска, как при
+// последовательном чтении; вершины и группы добавляются в порядке
+// файла, чтобы попасть в свои фигуры, а вершины чужих фигур копируются.
+Scene MergeInOrder(vector<ObjChunk> &chunks) {
+  SceneBuilder builder;
+  size_t vertex_count = 0, face_count = 0;
+  for (auto &chunk : chunks) {
+    vertex_count += chunk.vertex_count;
+    face_count += chunk.face_count;
+  }
+  builder.Reserve(vertex_count, face_count);
+
+  size_t vertex_offset = 0;
+  for (auto &chunk : chunks) {
+    size_t v = 0, begin = 0, g = 0;
+    auto add_vertices = [&](size_t count) {
+      for (; v < count; ++v) {
+        builder.AddVertex(chunk.vertices[v * 3], chunk.vertices[v * 3 + 1],
+                          chunk.vertices[v * 3 + 2]);
+      }
+    };
+    for (size_t f = 0;; ++f) {
+      const auto &groups = chunk.group_starts;
+      for (; g < groups.size() && groups[g].second == f; ++g) {
+        add_vertices(groups[g].first);
+        builder.BeginFigure();
+      }
+      if (f == chunk.face_ends.size()) break;
+      add_vertices(chunk.face_vertex_counts[f]);
+      builder.AddFace(chunk.numbers.data() + begin,
+                      chunk.face_ends[f] - begin,
+                      vertex_offset + chunk.face_vertex_counts[f]);
+      begin = chunk.face_ends[f];
+    }
+    add_vertices(chunk.vertices.size() / 3);
+    vertex_offset += chunk.vertices.size() / 3;
+    chunk = ObjChunk();
+  }
+  return builder.Build();
+}
+
+// Рёбра граней куска как ключи в сквозной нумерации, разложенные по
+// shard_count частям хеша ключа. false, если грань ссылается на вершину
+// прошлой фигуры: SceneBuilder копирует такие вершины в порядке первого
+// использования, и это слияние повторить не может.
+bool CollectEdges(ObjChunk &chunk, const vector<size_t> &figure_starts,
+                  size_t shard_count) {
+  chunk.keys.reserve(chunk.numbers.size());
+  chunk.shards.assign(shard_count, {});
+  size_t figure = chunk.first_figure;
+  size_t begin = 0, g = 0;
+  vector<uint32_t> indices;
+  indices.reserve(5);
+  for (size_t f = 0; f < chunk.face_ends.size(); ++f) {
+    for (; g < chunk.group_starts.size() &&
+           chunk.group_starts[g].second <= f;
+         ++g) {
+      ++figure;
+    }
+    if (chunk.runs.empty() || chunk.runs.back().first != figure) {
+      chunk.runs.emplace_back(figure, chunk.keys.size());
+    }
+    size_t limit = chunk.vertex_offset + chunk.face_vertex_counts[f];
+    indices.clear();
+    for (size_t n = begin; n < chunk.face_ends[f]; ++n) {
+      int idx = chunk.numbers[n] - 1;
+      if (idx < 0 || size_t(idx) >= limit) continue;
+      if (size_t(idx) < figure_starts[figure]) return false;
+      indices.push_back(idx);
+    }
+    begin = chunk.face_ends[f];
+    if (indices.size() < 2) continue;
+    for (size_t i = 0; i < indices.size(); ++i) {
+      uint64_t key = EdgeIndexSet::MakeKey(
+          indices[i], indices[(i + 1) % indices.size()]);
+      size_t shard = (key * 0x9E3779B97F4A7C15ull >> 32) % shard_count;
+      chunk.shards[shard].push_back(chunk.keys.size());
+      chunk.keys.push_back(key);
+    }
+  }
+  chunk.first_seen.assign(chunk.keys.size(), 0);
+  return chunk.keys.size() <= std::numeric_limits<uint32_t>::max();
+}
+}  // namespace
+
+ParallelFileReader::ParallelFileReader(unsigned threads, size_t min_chunk_size)
+    : threads_(threads), min_chunk_size_(std::max<size_t>(min_chunk_size, 1)) {
+  if (threads_ == 0) {
+    threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+Scene ParallelFileReader::ReadScene(string path,
+                                    NormalizationParameters params) {
+  if (threads_ == 1) {
+    return MappedFileReader::ReadScene(path, params);
+  }
+  MappedFile file(path);
+  if (!file.IsOpen()) return Scene();
+
+  const char *data = file.GetData();
+  const char *end = data + file.GetSize();
+  size_t chunk_count = std::min<size_t>(
+      threads_, std::max<size_t>(1, file.GetSize() / min_chunk_size_));
+
+  vector<const char *> bounds(chunk_count + 1, end);
+  bounds[0] = data;
+  for (size_t i = 1; i < chunk_count; ++i) {
+    const char *p = std::max(data + file.GetSize() / chunk_count * i,
+                             bounds[i - 1]);
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    bounds[i] = eol ? eol + 1 : end;
+  }
+
+  std::atomic<size_t> bytes_read = 0;
+  std::atomic<size_t> records_parsed = 0;
+  ChunkTick tick = [&](size_t bytes, size_t records) {
+    ReportProgress(bytes_read += bytes, file.GetSize(),
+                   records_parsed += records);
+    return !IsCancelled();
+  };
+
+  WorkerPool pool(chunk_count);
+  vector<ObjChunk> chunks(chunk_count);
+  // в потоковом режиме кусок публикуется, как только разобраны все
+  // предыдущие: тогда известны сквозные номера его вершин
+  std::mutex publish_mutex;
+  vector<uint8_t> parsed(chunk_count, 0);
+  size_t published = 0, published_vertices = 0;
+  pool.ParallelFor(chunk_count, [&](size_t i) {
+    ParseChunk(bounds[i], bounds[i + 1], chunks[i], tick);
+    if (!IsStreaming() || IsCancelled()) return;
+    std::lock_guard<std::mutex> lock(publish_mutex);
+    parsed[i] = 1;
+    for (; published < chunk_count && parsed[published]; ++published) {
+      const ObjChunk &chunk = chunks[published];
+      SendBatch(MakeChunkBatch(chunk, published_vertices));
+      published_vertices += chunk.vertices.size() / 3;
+    }
+  });
+  if (IsCancelled()) return Scene();
+
+  // Фигуры - отрезки между записями o/g: начало каждой в сквозной
+  // нумерации вершин. Отрезок без вершин SceneBuilder использует
+  // повторно, поэтому фигурой становится только отрезок с вершинами.
+  vector<size_t> figure_starts = {0};
+  size_t vertex_count = 0;
+  for (auto &chunk : chunks) {
+    chunk.vertex_offset = vertex_count;
+    chunk.first_figure = figure_starts.size() - 1;
+    for (const auto &group : chunk.group_starts) {
+      figure_starts.push_back(vertex_count + group.first);
+    }
+    vertex_count += chunk.vertices.size() / 3;
+  }
+  figure_starts.push_back(vertex_count);
+  if (vertex_count > std::numeric_limits<uint32_t>::max()) {
+    return MergeInOrder(chunks);
+  }
+
+  // Рёбра сливаются по частям хеша ключа параллельно: часть просматривает
+  // свои ключи кусок за куском в порядке файла, так что первое
+  // вхождение ключа в ней - первое и во всём файле. Отмеченные первые
+  // вхождения затем собираются в порядке файла, как их вставил бы
+  // SceneBuilder.
+  size_t shard_count = pool.GetThreadCount();
+  std::atomic<bool> in_order = true;
+  pool.ParallelFor(chunk_count, [&](size_t c) {
+    if (!CollectEdges(chunks[c], figure_starts, shard_count)) {
+      in_order.store(false, std::memory_order_relaxed);
+    }
+  });
+  if (!in_order.load()) return MergeInOrder(chunks);
+  if (IsCancelled()) return Scene();
+  for (auto &chunk : chunks) vector<int>().swap(chunk.numbers);
+  pool.ParallelFor(shard_count, [&](size_t shard) {
+    size_t expected = 0;
+    for (const auto &chunk : chunks) expected += chunk.shards[shard].size();
+    // в замкнутой сетке каждое ребро встречается в двух гранях
+    EdgeIndexSet seen;
+    seen.Reserve(expected / 2);
+    for (auto &chunk : chunks) {
+      for (uint32_t i : chunk.shards[shard]) {
+        uint64_t key = chunk.keys[i];
+        if (seen.Insert(key >> 32, key & 0xFFFFFFFFu)) {
+          chunk.first_seen[i] = 1;
+        }
+      }
+      vector<uint32_t>().swap(chunk.shards[shard]);
+    }
+  });
+
+  size_t figure_count = figure_starts.size() - 1;
+  // сколько рёбер каждого отрезка ключей осталось и куда они пишутся
+  vector<vector<size_t>> run_edges(chunk_count);
+  pool.ParallelFor(chunk_count, [&](size_t c) {
+    const ObjChunk &chunk = chunks[c];
+    for (size_t r = 0; r < chunk.runs.size(); ++r) {
+      size_t last =
+          r + 1 < chunk.runs.size() ? chunk.runs[r + 1].second
+                                    : chunk.keys.size();
+      size_t kept = 0;
+      for (size_t i = chunk.runs[r].second; i < last; ++i) {
+        kept += chunk.first_seen[i];
+      }
+      run_edges[c].push_back(kept);
+    }
+  });
+  vector<size_t> edge_counts(figure_count, 0);
+  for (size_t c = 0; c < chunk_count; ++c) {
+    for (size_t r = 0; r < chunks[c].runs.size(); ++r) {
+      size_t &count = edge_counts[chunks[c].runs[r].first];
+      size_t kept = run_edges[c][r];
+      run_edges[c][r] = count;
+      count += kept;
+    }
+  }
+
+  vector<vector<float>> positions(figure_count);
+  vector<EdgeArray> edges(figure_count);
+  for (size_t f = 0; f < figure_count; ++f) {
+    size_t count = figure_starts[f + 1] - figure_starts[f];
+    positions[f].resize(count * 3);
+    DispatchIndexWidth(count, [&](auto index) {
+      edges[f] = vector<BasicEdge<decltype(index)>>(edge_counts[f]);
+    });
+  }
+
+  // центр общей рамки, как в SceneBuilder::Build
+  vector<NormalizationParameters> boxes(chunk_count);
+  pool.ParallelFor(chunk_count, [&](size_t c) {
+    float min[3], max[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      min[axis] = std::numeric_limits<float>::max();
+      max[axis] = std::numeric_limits<float>::lowest();
+    }
+    const vector<float> &vertices = chunks[c].vertices;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+      min[i % 3] = std::min(min[i % 3], vertices[i]);
+      max[i % 3] = std::max(max[i % 3], vertices[i]);
+    }
+    boxes[c] = {min[0], max[0], min[1], max[1], min[2], max[2]};
+  });
+  NormalizationParameters box = boxes[0];
+  for (const auto &chunk_box : boxes) {
+    box.minX = std::min(box.minX, chunk_box.minX);
+    box.maxX = std::max(box.maxX, chunk_box.maxX);
+    box.minY = std::min(box.minY, chunk_box.minY);
+    box.maxY = std::max(box.maxY, chunk_box.maxY);
+    box.minZ = std::min(box.minZ, chunk_box.minZ);
+    box.maxZ = std::max(box.maxZ, chunk_box.maxZ);
+  }
+  double centre[3] = {box.minX + (box.maxX - box.minX) / 2,
+                      box.minY + (box.maxY - box.minY) / 2,
+                      box.minZ + (box.maxZ - box.minZ) / 2};
+
+  pool.ParallelFor(chunk_count, [&](size_t c) {
+    ObjChunk &chunk = chunks[c];
+    size_t figure = chunk.first_figure;
+    for (size_t v = 0; v < chunk.vertices.size() / 3; ++v) {
+      size_t global = chunk.vertex_offset + v;
+      while (global >= figure_starts[figure + 1]) ++figure;
+      float *out = &positions[figure][(global - figure_starts[figure]) * 3];
+      for (int axis = 0; axis < 3; ++axis) {
+        out[axis] = chunk.vertices[v * 3 + axis] - centre[axis];
+      }
+    }
+    vector<float>().swap(chunk.vertices);
+
+    for (size_t r = 0; r < chunk.runs.size(); ++r) {
+      auto [figure, first] = chunk.runs[r];
+      size_t last = r + 1 < chunk.runs.size() ? chunk.runs[r + 1].second
+                                              : chunk.keys.size();
+      size_t out = run_edges[c][r];
+      uint64_t base = figure_starts[figure];
+      std::visit(
+          [&](auto &array) {
+            using Edge = typename std::decay_t<decltype(array)>::value_type;
+            using Index = typename Edge::IndexType;
+            for (size_t i = first; i < last; ++i) {
+              if (!chunk.first_seen[i]) continue;
+              uint64_t key = chunk.keys[i];
+              array[out++] = Edge(Index((key >> 32) - base),
+                                  Index((key & 0xFFFFFFFFu) - base));
+            }
+          },
+          edges[figure]);
+    }
+    vector<uint64_t>().swap(chunk.keys);
+    vector<uint8_t>().swap(chunk.first_seen);
+  });
+
+  Scene scene;
+  for (size_t f = 0; f < figure_count; ++f) {
+    if (positions[f].empty()) continue;
+    auto figure = std::make_shared<Figure>();
+    std::visit([&](auto &array) { figure->setEdges(std::move(array)); },
+               edges[f]);
+    figure->setPositions(std::move(positions[f]));
+    scene.setFigures(figure);
+  }
+  return scene;
+}
@@ -0,0 +1,331 @@
+#include <cstring>
+
+#include "model.h"
+using namespace viewer;
+
+namespace {
+enum class PlyType { kInt8, kUInt8, kInt16, kUInt16, kInt32, kUInt32,
+                     kFloat32, kFloat64, kInvalid };
+
+struct PlyProperty {
+  string name;
+  PlyType type = PlyType::kInvalid;
+  // для списка type - тип элементов, count_type - тип длины
+  bool is_list = false;
+  PlyType count_type = PlyType::kInvalid;
+};
+
+struct PlyElement {
+  string name;
+  size_t count = 0;
+  vector<PlyProperty> properties;
+};
+
+struct PlyHeader {
+  std::endian order = std::endian::little;
+  vector<PlyElement> elements;
+  size_t size = 0;
+};
+
+PlyType ParseType(const string &name) {
+  static const pair<const char *, PlyType> kNames[] = {
+      {"char", PlyType::kInt8},     {"int8", PlyType::kInt8},
+      {"uchar", PlyType::kUInt8},   {"uint8", PlyType::kUInt8},
+      {"short", PlyType::kInt16},   {"int16", PlyType::kInt16},
+      {"ushort", PlyType::kUInt16}, {"uint16", PlyType::kUInt16},
+      {"int", PlyType::kInt32},     {"int32", PlyType::kInt32},
+      {"uint", PlyType::kUInt32},   {"uint32", PlyType::kUInt32},
+      {"float", PlyType::kFloat32}, {"float32", PlyType::kFloat32},
+      {"double", PlyType::kFloat64}, {"float64", PlyType::kFloat64}};
+  for (const auto &[type_name, type] : kNames) {
+    if (name == type_name) return type;
+  }
+  return PlyType::kInvalid;
+}
+
+size_t TypeSize(PlyType type) {
+  static const size_t kSizes[] = {1, 1, 2, 2, 4, 4, 4, 8, 0};
+  return kSizes[static_cast<int>(type)];
+}
+
+double LoadValue(const char *p, PlyType type, std::endian order) {
+  switch (type) {
+    case PlyType::kInt8:
+      return LoadUnaligned<int8_t>(p, order);
+    case PlyType::kUInt8:
+      return LoadUnaligned<uint8_t>(p, order);
+    case PlyType::kInt16:
+      return LoadUnaligned<int16_t>(p, order);
+    case PlyType::kUInt16:
+      return LoadUnaligned<uint16_t>(p, order);
+    case PlyType::kInt32:
+      return LoadUnaligned<int32_t>(p, order);
+    case PlyType::kUInt32:
+      return LoadUnaligned<uint32_t>(p, order);
+    case PlyType::kFloat32:
+      return LoadUnaligned<float>(p, order);
+    case PlyType::kFloat64:
+      return LoadUnaligned<double>(p, order);
+    default:
+      return 0;
+  }
+}
+
+bool IsInteger(PlyType type) {
+  return type != PlyType::kFloat32 && type != PlyType::kFloat64 &&
+         type != PlyType::kInvalid;
+}
+
+// Число записей из заголовка ограничивается тем, сколько записей
+// наименьшего размера (списки пустые) помещается в оставшиеся байты:
+// память под элементы выделяется по этим числам, а обрезанный файл и
+// так читается до последней целой записи.
+void FitCounts(size_t payload, PlyHeader &header) {
+  for (auto &element : header.elements) {
+    size_t record = 0;
+    for (const auto &property : element.properties) {
+      record += TypeSize(property.is_list ? property.count_type
+                                          : property.type);
+    }
+    element.count = record ? std::min(element.count, payload / record) : 0;
+    payload -= element.count * record;
+  }
+}
+
+// Разбирает текстовый заголовок; false для ASCII PLY и испорченных файлов.
+bool ParseHeader(const char *data, size_t size, PlyHeader &header) {
+  const char *end_marker = "end_header";
+  const char *p = data;
+  const char *end = data + size;
+  bool binary = false;
+  while (p < end) {
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (!eol) return false;
+    istringstream line(string(p, eol));
+    p = eol + 1;
+    string keyword;
+    line >> keyword;
+    if (keyword == end_marker) {
+      header.size = p - data;
+      if (binary) FitCounts(size - header.size, header);
+      return binary;
+    } else if (keyword == "format") {
+      string format;
+      line >> format;
+      binary = format == "binary_little_endian" ||
+               format == "binary_big_endian";
+      header.order = format == "binary_big_endian" ? std::endian::big
+                                                   : std::endian::little;
+    } else if (keyword == "element") {
+      PlyElement element;
+      if (!(line >> element.name >> element.count)) return false;
+      header.elements.push_back(element);
+    } else if (keyword == "property") {
+      if (header.elements.empty()) return false;
+      PlyProperty property;
+      string type;
+      line >> type;
+      if (type == "list") {
+        string count_type;
+        line >> count_type >> type;
+        property.is_list = true;
+        // длина списка с плавающей точкой не имеет смысла
+        property.count_type = ParseType(count_type);
+        if (!IsInteger(property.count_type)) return false;
+      }
+      property.type = ParseType(type);
+      if (property.type == PlyType::kInvalid || !(line >> property.name)) {
+        return false;
+      }
+      header.elements.back().properties.push_back(property);
+    }
+  }
+  return false;
+}
+
+// Смещения x, y, z в записи элемента без списков; -1, если свойства нет.
+// false, если у элемента есть список.
+bool FindCoordinates(const PlyElement &element, size_t &stride,
+                     array<ptrdiff_t, 3> &offsets, array<PlyType, 3> &types) {
+  stride = 0;
+  offsets = {-1, -1, -1};
+  types = {PlyType::kInvalid, PlyType::kInvalid, PlyType::kInvalid};
+  for (const auto &property : element.properties) {
+    if (property.is_list) return false;
+    if (property.name.size() == 1 && property.name[0] >= 'x' &&
+        property.name[0] <= 'z') {
+      offsets[property.name[0] - 'x'] = stride;
+      types[property.name[0] - 'x'] = property.type;
+    }
+    stride += TypeSize(property.type);
+  }
+  return true;
+}
+}  // namespace
+
+Scene PlyFileReader::ReadScene(string path, NormalizationParameters params) {
+  (void)params;
+  MappedFile file(path);
+  PlyHeader header;
+  if (!file.IsOpen() || !ParseHeader(file.GetData(), file.GetSize(), header)) {
+    return Scene();
+  }
+
+  size_t vertex_count = 0, face_count = 0;
+  for (const auto &element : header.elements) {
+    if (element.name == "vertex") vertex_count += element.count;
+    if (element.name == "face") face_count += element.count;
+  }
+  bool merge = mergeEdges_ &&
+               vertex_count <= std::numeric_limits<uint32_t>::max();
+  return DispatchIndexWidth(vertex_count, [&](auto index_type) {
+    using Index = decltype(index_type);
+    vector<float> positions(vertex_count * 3);
+    size_t vertices_read = 0;
+    // у замкнутой сетки из треугольников и четырёхугольников 1.5-2 ребра
+    // на грань; без слияния - по ребру на сторону
+    EdgeIndexSet merged;
+    vector<BasicEdge<Index>> edges;
+    if (merge) {
+      merged.Reserve(face_count * 2);
+    } else {
+      edges.reserve(face_count * 3);
+    }
+    BatchCursor cursor;
+    // обрезанный файл читается до последней целой записи
+    auto finish = [&]() {
+      positions.resize(vertices_read * 3);
+      if (!merge) return MakeScene(std::move(positions), std::move(edges));
+      return MakeScene(std::move(positions),
+                       merged.ToEdgeArray(vertices_read));
+    };
+    auto publish = [&](bool force) {
+      auto read = std::span<const float>(positions).first(vertices_read * 3);
+      if (merge) {
+        PublishBatch<uint64_t>(read, merged.GetKeys(), cursor, force);
+      } else {
+        PublishBatch<BasicEdge<Index>>(read, edges, cursor, force);
+      }
+    };
+
+    const char *p = file.GetData() + header.size;
+    const char *end = file.GetData() + file.GetSize();
+    const char *next_report = p + kProgressStep;
+    size_t records = 0;
+    vector<uint64_t> face;
+    face.reserve(5);
+    for (const auto &element : header.elements) {
+      bool is_vertex = element.name == "vertex";
+      bool is_face = element.name == "face";
+      size_t stride;
+      array<ptrdiff_t, 3> offsets;
+      array<PlyType, 3> types;
+      if (is_vertex && FindCoordinates(element, stride, offsets, types)) {
+        // записи одной длины: читаются блоками между проверками отмены
+        size_t block = kProgressStep / std::max<size_t>(stride, 1);
+        bool packed = stride == 3 * sizeof(float) &&
+                      header.order == std::endian::native &&
+                      offsets == array<ptrdiff_t, 3>{0, 4, 8} &&
+                      types == array<PlyType, 3>{PlyType::kFloat32,
+                                                 PlyType::kFloat32,
+                                                 PlyType::kFloat32};
+        for (size_t n = 0; n < element.count; n += block) {
+          if (IsCancelled()) return Scene();
+          ReportProgress(p - file.GetData(), file.GetSize(), records);
+          publish(false);
+          size_t available =
+              stride ? size_t(end - p) / stride : element.count;
+          size_t take = std::min({block, element.count - n, available});
+          float *out = positions.data() + vertices_read * 3;
+          if (packed) {
+            memcpy(out, p, take * stride);
+          } else {
+            for (size_t i = 0; i < take; ++i) {
+              for (int axis = 0; axis < 3; ++axis) {
+                if (offsets[axis] < 0) continue;
+                out[i * 3 + axis] = LoadValue(p + i * stride + offsets[axis],
+                                              types[axis], header.order);
+              }
+            }
+          }
+          p += take * stride;
+          vertices_read += take;
+          records += take;
+          if (take < block && n + take < element.count) return finish();
+        }
+        next_report = p + kProgressStep;
+        continue;
+      }
+      for (size_t n = 0; n < element.count; ++n) {
+        if (p >= next_report) {
+          if (IsCancelled()) return Scene();
+          ReportProgress(p - file.GetData(), file.GetSize(), records);
+          publish(false);
+          next_report = p + kProgressStep;
+        }
+        array<double, 3> ver = {0, 0, 0};
+        face.clear();
+        for (const auto &property : element.properties) {
+          size_t item_size = TypeSize(property.type);
+          if (!property.is_list) {
+            if (end - p < ptrdiff_t(item_size)) return finish();
+            if (is_vertex && property.name.size() == 1 &&
+                property.name[0] >= 'x' && property.name[0] <= 'z') {
+              ver[property.name[0] - 'x'] =
+                  LoadValue(p, property.type, header.order);
+            }
+            p += item_size;
+            continue;
+          }
+          size_t count_size = TypeSize(property.count_type);
+          if (end - p < ptrdiff_t(count_size)) return finish();
+          // отрицательная длина не приводится к size_t, а длинная
+          // сравнивается делением, чтобы произведение не переполнилось
+          double length = LoadValue(p, property.count_type, header.order);
+          p += count_size;
+          if (length < 0) return finish();
+          size_t count = length;
+          if (count > size_t(end - p) / item_size) return finish();
+          if (is_face && (property.name == "vertex_indices" ||
+                          property.name == "vertex_index")) {
+            for (size_t i = 0; i < count; ++i, p += item_size) {
+              // номер ещё не прочитанной вершины отбрасывается, как у
+              // OBJ; проверка до приведения к целому, для которого
+              // отрицательный или слишком большой номер не определён
+              double index = LoadValue(p, property.type, header.order);
+              if (index >= 0 && index < double(vertices_read)) {
+                face.push_back(uint64_t(index));
+              }
+            }
+          } else {
+            p += count * item_size;
+          }
+        }
+        if (is_vertex && vertices_read < vertex_count) {
+          for (int axis = 0; axis < 3; ++axis) {
+            positions[vertices_read * 3 + axis] = ver[axis];
+          }
+          ++vertices_read;
+          ++records;
+        } else if (is_face) {
+          // у грани из двух вершин одно ребро
+          size_t sides = face.size() == 2 ? 1 : face.size();
+          for (size_t i = 0; face.size() >= 2 && i < sides; ++i) {
+            uint64_t a = face[i];
+            uint64_t b = face[(i + 1) % face.size()];
+            if (merge) {
+              merged.Insert(a, b);
+            } else {
+              edges.emplace_back(Index(a), Index(b));
+            }
+          }
+          ++records;
+        }
+      }
+    }
+    if (IsCancelled()) return Scene();
+    ReportProgress(file.GetSize(), file.GetSize(), records);
+    publish(true);
+    return finish();
+  });
+}
@@ -0,0 +1,158 @@
+#include "model.h"
+using namespace viewer;
+
+SceneBuilder::SceneBuilder() : figures_(1) {
+  params_.minX = std::numeric_limits<float>::max();
+  params_.minY = std::numeric_limits<float>::max();
+  params_.minZ = std::numeric_limits<float>::max();
+  params_.maxX = std::numeric_limits<float>::lowest();
+  params_.maxY = std::numeric_limits<float>::lowest();
+  params_.maxZ = std::numeric_limits<float>::lowest();
+  indices_.reserve(5);
+}
+
+void SceneBuilder::Reserve(size_t vertex_count, size_t face_count) {
+  owners_.reserve(vertex_count);
+  copied_.reserve(vertex_count);
+  // в файлах без групп всё попадает в первую фигуру
+  figures_.back().positions.reserve(vertex_count * 3);
+  // у замкнутой сетки из треугольников и четырёхугольников 1.5-2 ребра
+  // на грань
+  figures_.back().edges.Reserve(face_count * 2);
+}
+
+void SceneBuilder::BeginFigure() {
+  const FigureData &current = figures_.back();
+  if (current.positions.empty() && current.edges.GetSize() == 0) return;
+  size_t first_vertex = current.first_vertex + current.positions.size() / 3;
+  figures_.emplace_back();
+  figures_.back().first_vertex = first_vertex;
+  borrowed_.clear();
+}
+
+void SceneBuilder::AddVertex(double x, double y, double z) {
+  FigureData &figure = figures_.back();
+  owners_.emplace_back(figures_.size() - 1, figure.positions.size() / 3);
+  copied_.push_back(false);
+  figure.positions.insert(figure.positions.end(),
+                          {(float)x, (float)y, (float)z});
+  params_.minX = std::min(params_.minX, (float)x);
+  params_.maxX = std::max(params_.maxX, (float)x);
+  params_.minY = std::min(params_.minY, (float)y);
+  params_.maxY = std::max(params_.maxY, (float)y);
+  params_.minZ = std::min(params_.minZ, (float)z);
+  params_.maxZ = std::max(params_.maxZ, (float)z);
+}
+
+uint32_t SceneBuilder::LocalIndex(uint32_t vertex) {
+  auto [owner, local] = owners_[vertex];
+  if (owner == figures_.size() - 1) return local;
+  auto [it, inserted] = borrowed_.try_emplace(vertex, 0);
+  if (inserted) {
+    FigureData &figure = figures_.back();
+    it->second = figure.positions.size() / 3;
+    const float *position = &figures_[owner].positions[local * 3];
+    figure.positions.insert(figure.positions.end(), position, position + 3);
+    copied_[vertex] = true;
+  }
+  return it->second;
+}
+
+void SceneBuilder::AddFace(const vector<int> &numbers) {
+  AddFace(numbers.data(), numbers.size(), owners_.size());
+}
+
+void SceneBuilder::AddFace(const int *numbers, size_t count,
+                           size_t vertex_limit) {
+  vertex_limit = std::min(vertex_limit, owners_.size());
+  indices_.clear();
+  for (size_t n = 0; n < count; ++n) {
+    int idx = numbers[n] - 1;
+    if (idx >= 0 && static_cast<size_t>(idx) < vertex_limit) {
+      indices_.push_back(LocalIndex(idx));
+    }
+  }
+
+  if (indices_.size() >= 2) {
+    EdgeIndexSet &edges = figures_.back().edges;
+    for (size_t i = 0; i < indices_.size(); ++i) {
+      size_t next = (i + 1) % indices_.size();
+      edges.Insert(indices_[i], indices_[next]);
+    }
+  }
+}
+
+bool SceneBuilder::TakeBatch(GeometryBatch &batch) {
+  batch.first_vertex = figures_[batchFigure_].first_vertex + batchVertices_;
+  batch.positions.clear();
+  batch.edges.clear();
+  // закрытые фигуры больше не растут, поэтому сквозные номера их вершин
+  // не меняются
+  for (;; ++batchFigure_, batchVertices_ = 0, batchEdges_ = 0) {
+    const FigureData &figure = figures_[batchFigure_];
+    const vector<uint64_t> &keys = figure.edges.GetKeys();
+    batch.positions.insert(batch.positions.end(),
+                           figure.positions.begin() + batchVertices_ * 3,
+                           figure.positions.end());
+    for (size_t i = batchEdges_; i < keys.size(); ++i) {
+      batch.edges.push_back(figure.first_vertex + (keys[i] >> 32));
+      batch.edges.push_back(figure.first_vertex + (keys[i] & 0xFFFFFFFFu));
+    }
+    batchVertices_ = figure.positions.size() / 3;
+    batchEdges_ = keys.size();
+    if (batchFigure_ + 1 == figures_.size()) break;
+  }
+  return !batch.positions.empty() || !batch.edges.empty();
+}
+
+void SceneBuilder::DropCopiedPoints() {
+  // у фигуры без рёбер вершины рисуются только точками, а скопированные
+  // уже нарисованы фигурами, которые на них опираются
+  vector<vector<bool>> dropped(figures_.size());
+  for (size_t vertex = 0; vertex < owners_.size(); ++vertex) {
+    auto [owner, local] = owners_[vertex];
+    const FigureData &figure = figures_[owner];
+    if (!copied_[vertex] || figure.edges.GetSize() != 0) continue;
+    if (dropped[owner].empty()) {
+      dropped[owner].resize(figure.positions.size() / 3);
+    }
+    dropped[owner][local] = true;
+  }
+  for (size_t f = 0; f < figures_.size(); ++f) {
+    if (dropped[f].empty()) continue;
+    vector<float> &positions = figures_[f].positions;
+    size_t kept = 0;
+    for (size_t i = 0; i < dropped[f].size(); ++i) {
+      if (dropped[f][i]) continue;
+      std::copy_n(&positions[i * 3], 3, &positions[kept * 3]);
+      ++kept;
+    }
+    positions.resize(kept * 3);
+  }
+}
+
+Scene SceneBuilder::Build() {
+  DropCopiedPoints();
+  Scene scene;
+  // фигуры центрируются по общей рамке, чтобы сборка не разъезжалась
+  double centrX = params_.minX + (params_.maxX - params_.minX) / 2;
+  double centrY = params_.minY + (params_.maxY - params_.minY) / 2;
+  double centrZ = params_.minZ + (params_.maxZ - params_.minZ) / 2;
+
+  for (FigureData &data : figures_) {
+    if (data.positions.empty()) continue;
+    auto figure = std::make_shared<Figure>();
+    for (size_t i = 0; i < data.positions.size(); i += 3) {
+      data.positions[i] -= centrX;
+      data.positions[i + 1] -= centrY;
+      data.positions[i + 2] -= centrZ;
+    }
+    // у файлов с группами запас, сделанный Reserve, достаётся первой фигуре
+    data.positions.shrink_to_fit();
+    std::visit([&](auto &&edges) { figure->setEdges(std::move(edges)); },
+               data.edges.ToEdgeArray(data.positions.size() / 3));
+    figure->setPositions(std::move(data.positions));
+    scene.setFigures(figure);
+  }
+  return scene;
+}
@@ -0,0 +1,226 @@
+#include <cctype>
+#include <cstring>
+
+#include "model.h"
+using namespace viewer;
+
+namespace {
+constexpr size_t kHeaderSize = 84;
+constexpr size_t kTriangleSize = 50;
+
+// Открытая адресация по побитовому представлению позиции: STL
+// повторяет каждую вершину в среднем шесть раз. Позиции вершин копятся
+// прямо в массив будущей фигуры.
+class PositionWelder {
+ public:
+  explicit PositionWelder(size_t expected) {
+    positions_.reserve(expected * 3);
+    Rehash(expected * 2);
+  }
+
+  // Номер вершины с позицией p; новая позиция получает следующий по
+  // порядку номер. -0.0f в p уже заменён на 0.0f.
+  uint32_t Weld(const float p[3]) {
+    if ((GetCount() + 1) * 2 > slots_.size()) Rehash(slots_.size() * 2);
+    size_t mask = slots_.size() - 1;
+    for (size_t i = Slot(p);; i = (i + 1) & mask) {
+      uint32_t index = slots_[i];
+      if (index == kEmpty) {
+        index = GetCount();
+        slots_[i] = index;
+        positions_.insert(positions_.end(), p, p + 3);
+        return index;
+      }
+      if (memcmp(&positions_[index * 3], p, sizeof(float) * 3) == 0) {
+        return index;
+      }
+    }
+  }
+
+  size_t GetCount() const { return positions_.size() / 3; }
+  vector<float> &GetPositions() { return positions_; }
+
+ private:
+  static constexpr uint32_t kEmpty = ~0u;
+
+  size_t Slot(const float p[3]) const {
+    auto bits = [p](int axis) { return std::bit_cast<uint32_t>(p[axis]); };
+    uint64_t h = (uint64_t(bits(0)) << 32 | bits(1)) ^
+                 (uint64_t(bits(2)) * 0x9E3779B1u);
+    return (h * 0x9E3779B97F4A7C15ull) >> shift_;
+  }
+
+  void Rehash(size_t min_capacity) {
+    size_t capacity = 16;
+    while (capacity < min_capacity) capacity <<= 1;
+    slots_.assign(capacity, kEmpty);
+    shift_ = 64 - std::countr_zero(capacity);
+    for (size_t index = 0; index < GetCount(); ++index) {
+      size_t i = Slot(&positions_[index * 3]);
+      while (slots_[i] != kEmpty) i = (i + 1) & (capacity - 1);
+      slots_[i] = index;
+    }
+  }
+
+  vector<uint32_t> slots_;
+  vector<float> positions_;
+  int shift_;
+};
+
+// Текстовый STL начинается со слова solid. С него же начинают заголовок
+// и некоторые двоичные, поэтому сначала проверяется размер двоичного.
+bool IsAsciiStl(const char *data, size_t size) {
+  const char *end = data + size;
+  while (data < end && isspace(static_cast<unsigned char>(*data))) ++data;
+  return end - data >= 5 && memcmp(data, "solid", 5) == 0;
+}
+
+// Ключевое слово в начале строки [line, eol) после отступа; возвращает
+// указатель за ним или nullptr.
+const char *AfterKeyword(const char *line, const char *eol,
+                         const char *keyword) {
+  while (line < eol && (*line == ' ' || *line == '\t')) ++line;
+  size_t n = strlen(keyword);
+  if (size_t(eol - line) < n || memcmp(line, keyword, n) != 0) return nullptr;
+  return line + n;
+}
+}  // namespace
+
+Scene StlFileReader::ReadScene(string path, NormalizationParameters params) {
+  (void)params;
+  MappedFile file(path);
+  if (!file.IsOpen()) return Scene();
+  // у двоичного STL размер однозначно задан числом треугольников;
+  // обрезанный или дописанный файл не читается
+  if (file.GetSize() >= kHeaderSize &&
+      file.GetSize() ==
+          kHeaderSize + kTriangleSize * uint64_t(LoadUnaligned<uint32_t>(
+                                            file.GetData() + 80))) {
+    return weld_ ? ReadBinary(file) : ReadBinaryUnwelded(file);
+  }
+  if (IsAsciiStl(file.GetData(), file.GetSize())) return ReadAscii(file);
+  return Scene();
+}
+
+Scene StlFileReader::ReadBinary(const MappedFile &file) {
+  size_t count = (file.GetSize() - kHeaderSize) / kTriangleSize;
+  // у замкнутой сетки вершин примерно вдвое меньше, чем треугольников,
+  // а рёбер в полтора раза больше
+  PositionWelder welder(count / 2 + 3);
+  EdgeIndexSet edges;
+  edges.Reserve(count * 3 / 2);
+  BatchCursor cursor;
+
+  const char *p = file.GetData() + kHeaderSize;
+  size_t next_report = kProgressStep / kTriangleSize;
+  for (size_t t = 0; t < count; ++t, p += kTriangleSize) {
+    if (t == next_report) {
+      if (IsCancelled()) return Scene();
+      ReportProgress(p - file.GetData(), file.GetSize(), t);
+      PublishBatch<uint64_t>(welder.GetPositions(), edges.GetKeys(), cursor);
+      next_report += kProgressStep / kTriangleSize;
+    }
+    uint32_t face[3];
+    for (int v = 0; v < 3; ++v) {
+      // 12 байт нормали, затем три вершины по три float
+      const char *vertex = p + 12 + v * 12;
+      float position[3];
+      for (int axis = 0; axis < 3; ++axis) {
+        position[axis] = LoadUnaligned<float>(vertex + axis * 4) + 0.0f;
+      }
+      face[v] = welder.Weld(position);
+    }
+    edges.Insert(face[0], face[1]);
+    edges.Insert(face[1], face[2]);
+    edges.Insert(face[2], face[0]);
+  }
+  if (IsCancelled()) return Scene();
+  ReportProgress(file.GetSize(), file.GetSize(), count);
+  PublishBatch<uint64_t>(welder.GetPositions(), edges.GetKeys(), cursor,
+                         true);
+  return MakeScene(std::move(welder.GetPositions()),
+                   edges.ToEdgeArray(welder.GetCount()));
+}
+
+Scene StlFileReader::ReadBinaryUnwelded(const MappedFile &file) {
+  size_t count = (file.GetSize() - kHeaderSize) / kTriangleSize;
+  vector<float> positions(count * 9);
+  return DispatchIndexWidth(count * 3, [&](auto index) {
+    using Index = decltype(index);
+    vector<BasicEdge<Index>> edges(count * 3);
+    BatchCursor cursor;
+    const char *p = file.GetData() + kHeaderSize;
+    size_t next_report = kProgressStep / kTriangleSize;
+    for (size_t t = 0; t < count; ++t, p += kTriangleSize) {
+      if (t == next_report) {
+        if (IsCancelled()) return Scene();
+        ReportProgress(p - file.GetData(), file.GetSize(), t);
+        PublishBatch(std::span<const float>(positions).first(t * 9),
+                     std::span<const BasicEdge<Index>>(edges).first(t * 3),
+                     cursor);
+        next_report += kProgressStep / kTriangleSize;
+      }
+      // девять float вершин идут за 12 байтами нормали
+      for (int i = 0; i < 9; ++i) {
+        positions[t * 9 + i] = LoadUnaligned<float>(p + 12 + i * 4);
+      }
+      auto first = Index(t * 3);
+      edges[t * 3] = BasicEdge<Index>(first, first + 1);
+      edges[t * 3 + 1] = BasicEdge<Index>(first + 1, first + 2);
+      edges[t * 3 + 2] = BasicEdge<Index>(first + 2, first);
+    }
+    if (IsCancelled()) return Scene();
+    ReportProgress(file.GetSize(), file.GetSize(), count);
+    PublishBatch(std::span<const float>(positions),
+                 std::span<const BasicEdge<Index>>(edges), cursor, true);
+    return MakeScene(std::move(positions), std::move(edges));
+  });
+}
+
+Scene StlFileReader::ReadAscii(const MappedFile &file) {
+  // facet с отступами занимает около 250 байт
+  PositionWelder welder(weld_ ? file.GetSize() / 512 + 3 : 0);
+  vector<float> &positions = welder.GetPositions();
+  EdgeIndexSet edges;
+  BatchCursor cursor;
+  const char *p = file.GetData();
+  const char *end = p + file.GetSize();
+  const char *next_report = p + kProgressStep;
+  size_t records = 0;
+  vector<uint32_t> face;
+  while (p < end) {
+    if (p >= next_report) {
+      if (IsCancelled()) return Scene();
+      ReportProgress(p - file.GetData(), file.GetSize(), records);
+      PublishBatch<uint64_t>(positions, edges.GetKeys(), cursor);
+      next_report = p + kProgressStep;
+    }
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (!eol) eol = end;
+    array<double, 3> ver;
+    if (const char *rest = AfterKeyword(p, eol, "vertex")) {
+      if (ObjRecordParser::ParseVertex(rest, eol, ver)) {
+        float position[3] = {float(ver[0]) + 0.0f, float(ver[1]) + 0.0f,
+                             float(ver[2]) + 0.0f};
+        if (weld_) {
+          face.push_back(welder.Weld(position));
+        } else {
+          face.push_back(positions.size() / 3);
+          positions.insert(positions.end(), position, position + 3);
+        }
+      }
+    } else if (AfterKeyword(p, eol, "endloop")) {
+      for (size_t i = 0; face.size() >= 2 && i < face.size(); ++i) {
+        edges.Insert(face[i], face[(i + 1) % face.size()]);
+      }
+      face.clear();
+      ++records;
+    }
+    p = eol + 1;
+  }
+  if (IsCancelled()) return Scene();
+  ReportProgress(file.GetSize(), file.GetSize(), records);
+  PublishBatch<uint64_t>(positions, edges.GetKeys(), cursor, true);
+  size_t vertex_count = positions.size() / 3;
+  return MakeScene(std::move(positions), edges.ToEdgeArray(vertex_count));
+}
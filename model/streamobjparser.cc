@@ -0,0 +1,299 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "model.h"
+using namespace viewer;
+
+namespace {
+struct Block {
+  vector<char> data;
+  size_t size = 0;
+};
+
+// Кольцо из фиксированного числа блоков между потоком распаковки и
+// разбором: распаковка ждёт свободный блок, разбор — заполненный.
+class BlockRing {
+ public:
+  BlockRing(size_t block_size, size_t block_count) : blocks_(block_count) {
+    for (auto &block : blocks_) {
+      block.data.resize(block_size);
+      free_.push_back(&block);
+    }
+  }
+
+  // Свободный блок для записи; nullptr, если кольцо закрыто.
+  Block *AcquireFree() {
+    unique_lock<mutex> lock(mutex_);
+    freeReady_.wait(lock, [this] { return closed_ || !free_.empty(); });
+    if (closed_) return nullptr;
+    Block *block = free_.front();
+    free_.pop_front();
+    return block;
+  }
+
+  void PushFull(Block *block) {
+    lock_guard<mutex> lock(mutex_);
+    full_.push_back(block);
+    fullReady_.notify_one();
+  }
+
+  // Следующий заполненный блок; nullptr, когда данные кончились.
+  Block *PopFull() {
+    unique_lock<mutex> lock(mutex_);
+    fullReady_.wait(lock, [this] { return finished_ || !full_.empty(); });
+    if (full_.empty()) return nullptr;
+    Block *block = full_.front();
+    full_.pop_front();
+    return block;
+  }
+
+  void Release(Block *block) {
+    lock_guard<mutex> lock(mutex_);
+    free_.push_back(block);
+    freeReady_.notify_one();
+  }
+
+  // Вызывается распаковкой после последнего блока.
+  void Finish() {
+    lock_guard<mutex> lock(mutex_);
+    finished_ = true;
+    fullReady_.notify_one();
+  }
+
+  // Вызывается разбором при отмене, чтобы распаковка не ждала вечно.
+  void Close() {
+    lock_guard<mutex> lock(mutex_);
+    closed_ = true;
+    freeReady_.notify_one();
+  }
+
+  bool IsClosed() {
+    lock_guard<mutex> lock(mutex_);
+    return closed_;
+  }
+
+ private:
+  vector<Block> blocks_;
+  deque<Block *> free_;
+  deque<Block *> full_;
+  mutex mutex_;
+  condition_variable freeReady_;
+  condition_variable fullReady_;
+  bool finished_ = false;
+  bool closed_ = false;
+};
+
+// Распаковка gzip (в том числе из нескольких членов подряд) или, если
+// данные начинаются не с сигнатуры gzip, копирование их как есть.
+// Дескриптор ждётся через poll с таймаутом, поэтому поток не застревает
+// навсегда на stdin или канале, в который ничего не пишут: между
+// ожиданиями он спрашивает stop, не пора ли остановиться.
+class Inflater {
+ public:
+  enum class Status { kData, kEnd, kError, kStopped };
+
+  // Дескриптор переходит во владение.
+  explicit Inflater(int fd) : fd_(fd), input_(1 << 17) {}
+  ~Inflater() {
+    if (mode_ == Mode::kGzip) inflateEnd(&stream_);
+    close(fd_);
+  }
+  Inflater(const Inflater &) = delete;
+  Inflater &operator=(const Inflater &) = delete;
+
+  // Записывает в out до size байт, written - сколько записано. Уже
+  // полученные данные возвращаются, не дожидаясь следующих. kError -
+  // ошибка чтения, повреждённый или обрезанный gzip.
+  Status Read(char *out, size_t size, size_t &written,
+              const function<bool()> &stop) {
+    written = 0;
+    while (written < size && !ended_) {
+      if (stream_.avail_in == 0) {
+        if (written > 0) break;
+        Status status = Fill(stop);
+        if (status == Status::kEnd) {
+          ended_ = true;
+          if (memberOpen_) return Status::kError;
+          break;
+        }
+        if (status != Status::kData) return status;
+      }
+      if (mode_ == Mode::kUnknown) {
+        mode_ = stream_.next_in[0] == 0x1f ? Mode::kGzip : Mode::kRaw;
+        // 16 - только gzip, с проверкой CRC
+        if (mode_ == Mode::kGzip &&
+            inflateInit2(&stream_, 15 + 16) != Z_OK) {
+          mode_ = Mode::kRaw;
+          return Status::kError;
+        }
+        memberOpen_ = mode_ == Mode::kGzip;
+      }
+      if (mode_ == Mode::kRaw) {
+        size_t n = std::min<size_t>(stream_.avail_in, size - written);
+        memcpy(out + written, stream_.next_in, n);
+        stream_.next_in += n;
+        stream_.avail_in -= n;
+        written += n;
+        continue;
+      }
+      if (!memberOpen_) {
+        // как и gzread, мусор после последнего члена пропускается
+        if (stream_.next_in[0] != 0x1f) {
+          ended_ = true;
+          break;
+        }
+        inflateReset(&stream_);
+        memberOpen_ = true;
+      }
+      stream_.next_out = reinterpret_cast<Bytef *>(out + written);
+      stream_.avail_out = size - written;
+      int result = inflate(&stream_, Z_NO_FLUSH);
+      written = size - stream_.avail_out;
+      if (result == Z_STREAM_END) {
+        memberOpen_ = false;
+      } else if (result != Z_OK && result != Z_BUF_ERROR) {
+        return Status::kError;
+      }
+    }
+    return written > 0 ? Status::kData : Status::kEnd;
+  }
+
+  // Сколько байт прочитано из дескриптора.
+  size_t GetBytesRead() const { return bytesRead_; }
+
+ private:
+  enum class Mode { kUnknown, kRaw, kGzip };
+  static constexpr int kPollMilliseconds = 50;
+
+  Status Fill(const function<bool()> &stop) {
+    while (true) {
+      pollfd descriptor = {fd_, POLLIN, 0};
+      int ready = poll(&descriptor, 1, kPollMilliseconds);
+      if (ready == 0 || (ready < 0 && errno == EINTR)) {
+        if (stop()) return Status::kStopped;
+        continue;
+      }
+      if (ready < 0) return Status::kError;
+      ssize_t n = read(fd_, input_.data(), input_.size());
+      if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+      if (n < 0) return Status::kError;
+      if (n == 0) return Status::kEnd;
+      stream_.next_in = input_.data();
+      stream_.avail_in = n;
+      bytesRead_ += n;
+      return Status::kData;
+    }
+  }
+
+  int fd_;
+  vector<unsigned char> input_;
+  z_stream stream_ = {};
+  Mode mode_ = Mode::kUnknown;
+  // внутри члена gzip: конец файла здесь означает обрезанные данные
+  bool memberOpen_ = false;
+  bool ended_ = false;
+  size_t bytesRead_ = 0;
+};
+}  // namespace
+
+StreamFileReader::StreamFileReader(size_t block_size, size_t block_count)
+    : block_size_(std::max<size_t>(block_size, 1)),
+      block_count_(std::max<size_t>(block_count, 2)) {}
+
+Scene StreamFileReader::ReadScene(string path,
+                                  NormalizationParameters params) {
+  (void)params;
+  SceneBuilder builder;
+  // Inflater закрывает дескриптор сам, поэтому stdin дублируется.
+  int fd = path == "-" ? dup(STDIN_FILENO) : open(path.c_str(), O_RDONLY);
+  if (fd < 0) return builder.Build();
+  struct stat st;
+  size_t total = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? st.st_size : 0;
+  Inflater source(fd);
+
+  BlockRing ring(block_size_, block_count_);
+  atomic<size_t> compressed_read{0};
+  atomic<bool> failed{false};
+  // распаковка, ждущая данных, замечает отмену сама: разбор в это время
+  // стоит в PopFull
+  function<bool()> stop = [&] { return ring.IsClosed() || IsCancelled(); };
+  thread inflater([&] {
+    while (Block *block = ring.AcquireFree()) {
+      size_t n;
+      Inflater::Status status =
+          source.Read(block->data.data(), block->data.size(), n, stop);
+      if (status != Inflater::Status::kData) {
+        failed.store(status == Inflater::Status::kError);
+        ring.Release(block);
+        break;
+      }
+      block->size = n;
+      compressed_read.store(source.GetBytesRead(), memory_order_relaxed);
+      ring.PushFull(block);
+    }
+    ring.Finish();
+  });
+
+  // Строка, начатая в одном блоке и продолжающаяся в следующих.
+  string carry;
+  vector<int> numbers;
+  numbers.reserve(5);
+  size_t records = 0, consumed = 0, next_report = kProgressStep;
+  bool cancelled = false;
+  while (Block *block = ring.PopFull()) {
+    const char *p = block->data.data();
+    const char *end = p + block->size;
+    if (!carry.empty()) {
+      const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+      carry.append(p, eol ? eol : end);
+      if (eol) {
+        records += ObjRecordParser::ParseLine(
+            carry.data(), carry.data() + carry.size(), builder, numbers);
+        carry.clear();
+        p = eol + 1;
+      } else {
+        p = end;
+      }
+    }
+    while (p < end) {
+      const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+      if (!eol) {
+        carry.assign(p, end);
+        break;
+      }
+      records += ObjRecordParser::ParseLine(p, eol, builder, numbers);
+      p = eol + 1;
+    }
+    consumed += block->size;
+    ring.Release(block);
+    if (consumed >= next_report) {
+      if (IsCancelled()) {
+        cancelled = true;
+        break;
+      }
+      ReportProgress(compressed_read.load(memory_order_relaxed), total,
+                     records);
+      PublishBatch(builder);
+      next_report = consumed + kProgressStep;
+    }
+  }
+  ring.Close();
+  inflater.join();
+  // повреждённый или обрезанный gzip и ошибка чтения - неудачная загрузка
+  if (cancelled || IsCancelled() || failed.load()) return Scene();
+  records += ObjRecordParser::ParseLine(
+      carry.data(), carry.data() + carry.size(), builder, numbers);
+  ReportProgress(total ? total : compressed_read.load(), total, records);
+  PublishBatch(builder, true);
+  return builder.Build();
+}
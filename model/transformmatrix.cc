@@ -8,6 +8,15 @@ TransformMatrix::TransformMatrix() : matrix_() {
   }
 }
 
+TransformMatrix::TransformMatrix(const AffineMatrix &affine)
+    : TransformMatrix() {
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      matrix_[i][j] = affine.Get(i, j);
+    }
+  }
+}
+
 void TransformMatrix::setMatrixElement(int row, int col, double value) {
   matrix_[row][col] = value;
 }
@@ -1,99 +1,36 @@
 #include "model.h"
 using namespace viewer;
-TransformMatrix TransformMatrixBuilder::CreateRotationMatrix(double x, double y,
-                                                             double z) {
-  TransformMatrix final;
-
-  double radX = x * M_PI / 180.0;
-  double radY = y * M_PI / 180.0;
-  double radZ = z * M_PI / 180.0;
-
-  TransformMatrix rotationX;
-  rotationX.setMatrixElement(0, 0, 1.0f);
-  rotationX.setMatrixElement(0, 1, 0.0f);
-  rotationX.setMatrixElement(0, 2, 0.0f);
-  rotationX.setMatrixElement(0, 3, 0.0f);
-  rotationX.setMatrixElement(1, 0, 0.0f);
-  rotationX.setMatrixElement(1, 1, cos(radX));
-  rotationX.setMatrixElement(1, 2, -sin(radX));
-  rotationX.setMatrixElement(1, 3, 0.0f);
-  rotationX.setMatrixElement(2, 0, 0.0f);
-  rotationX.setMatrixElement(2, 1, sin(radX));
-  rotationX.setMatrixElement(2, 2, cos(radX));
-  rotationX.setMatrixElement(2, 3, 0.0f);
-  rotationX.setMatrixElement(3, 0, 0.0f);
-  rotationX.setMatrixElement(3, 1, 0.0f);
-  rotationX.setMatrixElement(3, 2, 0.0f);
-  rotationX.setMatrixElement(3, 3, 1.0f);
 
-  TransformMatrix rotationY;
-  rotationY.setMatrixElement(0, 0, cos(radY));
-  rotationY.setMatrixElement(0, 1, 0.0f);
-  rotationY.setMatrixElement(0, 2, sin(radY));
-  rotationY.setMatrixElement(0, 3, 0.0f);
-  rotationY.setMatrixElement(1, 0, 0.0f);
-  rotationY.setMatrixElement(1, 1, 1.0f);
-  rotationY.setMatrixElement(1, 2, 0.0f);
-  rotationY.setMatrixElement(1, 3, 0.0f);
-  rotationY.setMatrixElement(2, 0, -sin(radY));
-  rotationY.setMatrixElement(2, 1, 0.0f);
-  rotationY.setMatrixElement(2, 2, cos(radY));
-  rotationY.setMatrixElement(2, 3, 0.0f);
-  rotationY.setMatrixElement(3, 0, 0.0f);
-  rotationY.setMatrixElement(3, 1, 0.0f);
-  rotationY.setMatrixElement(3, 2, 0.0f);
-  rotationY.setMatrixElement(3, 3, 1.0f);
-
-  TransformMatrix rotationZ;
-  rotationZ.setMatrixElement(0, 0, cos(radZ));
-  rotationZ.setMatrixElement(0, 1, -sin(radZ));
-  rotationZ.setMatrixElement(0, 2, 0.0f);
-  rotationZ.setMatrixElement(0, 3, 0.0f);
-  rotationZ.setMatrixElement(1, 0, sin(radZ));
-  rotationZ.setMatrixElement(1, 1, cos(radZ));
-  rotationZ.setMatrixElement(1, 2, 0.0f);
-  rotationZ.setMatrixElement(1, 3, 0.0f);
-  rotationZ.setMatrixElement(2, 0, 0.0f);
-  rotationZ.setMatrixElement(2, 1, 0.0f);
-  rotationZ.setMatrixElement(2, 2, 1.0f);
-  rotationZ.setMatrixElement(2, 3, 0.0f);
-  rotationZ.setMatrixElement(3, 0, 0.0f);
-  rotationZ.setMatrixElement(3, 1, 0.0f);
-  rotationZ.setMatrixElement(3, 2, 0.0f);
-  rotationZ.setMatrixElement(3, 3, 1.0f);
+namespace {
+// gcc объединяет sin и cos одного аргумента в один вызов sincos.
+void SinCos(double degrees, float &sin, float &cos) {
+  double rad = degrees * M_PI / 180.0;
+  sin = std::sin(rad);
+  cos = std::cos(rad);
+}
+}  // namespace
+
+AffineMatrix AffineMatrix::FromTrs(const array<float, 3> &move,
+                                   const array<float, 3> &rotate,
+                                   const array<float, 3> &scale) {
+  array<float, 3> sin, cos;
+  for (int axis = 0; axis < 3; ++axis) {
+    SinCos(rotate[axis], sin[axis], cos[axis]);
+  }
+  return FromTrs(move, sin, cos, scale);
+}
 
-  final = rotationZ * rotationY * rotationX;
-  return final;
+TransformMatrix TransformMatrixBuilder::CreateRotationMatrix(double x, double y,
+                                                             double z) {
+  return TransformMatrix(AffineMatrix::Rotation(x, y, z));
 }
 
 TransformMatrix TransformMatrixBuilder::CreateMoveMatrix(double x, double y,
                                                          double z) {
-  TransformMatrix final;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      final.setMatrixElement(i, j, (i == j) ? 1.0f : 0.0f);
-    }
-  }
-  final.setMatrixElement(0, 3,
-                         static_cast<float>(x));
-  final.setMatrixElement(1, 3, static_cast<float>(y));
-  final.setMatrixElement(2, 3, static_cast<float>(z));
-  return final;
+  return TransformMatrix(AffineMatrix::Translation(x, y, z));
 }
 
 TransformMatrix TransformMatrixBuilder::CreateScaleMatrix(double x, double y,
                                                           double z) {
-  TransformMatrix final;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      final.setMatrixElement(i, j, 0.0f);
-    }
-  }
-  final.setMatrixElement(0, 0,
-                         static_cast<float>(x));
-  final.setMatrixElement(1, 1, static_cast<float>(y));
-  final.setMatrixElement(2, 2, static_cast<float>(z));
-  final.setMatrixElement(3, 3, 1.0f);
-
-  return final;
-}
\ No newline at end of file
+  return TransformMatrix(AffineMatrix::Scaling(x, y, z));
+}
@@ -0,0 +1,200 @@
+#include "model.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VIEWER_X86 1
+#endif
+
+using namespace viewer;
+
+namespace {
+using Rows = AffineMatrix::Rows;
+
+void TransformScalar(const Rows &m, const float *in, float *out,
+                     size_t count) {
+  for (size_t i = 0; i < count * 3; i += 3) {
+    float x = in[i], y = in[i + 1], z = in[i + 2];
+    out[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
+    out[i + 1] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
+    out[i + 2] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+  }
+}
+
+#ifdef VIEWER_X86
+// Ядра берут по 4, 8 или 16 точек: три вектора x y z подряд
+// раскладываются в отдельные векторы x, y и z, преобразуются и
+// собираются обратно. Перестановка внутри каждой 128-битной дорожки
+// одинакова для всех ширин, так что порядок точек в x, y, z совпадает и
+// обратная перестановка возвращает его.
+
+__attribute__((target("sse2"))) size_t TransformSse(const Rows &m,
+                                                    const float *in,
+                                                    float *out,
+                                                    size_t count) {
+  __m128 c[3][4];
+  for (int r = 0; r < 3; ++r) {
+    for (int k = 0; k < 4; ++k) c[r][k] = _mm_set1_ps(m[r][k]);
+  }
+  size_t done = 0;
+  for (; done + 4 <= count; done += 4, in += 12, out += 12) {
+    __m128 m0 = _mm_loadu_ps(in);
+    __m128 m1 = _mm_loadu_ps(in + 4);
+    __m128 m2 = _mm_loadu_ps(in + 8);
+    __m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+    __m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+    __m128 x = _mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    __m128 y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    __m128 z = _mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+    __m128 r[3];
+    for (int k = 0; k < 3; ++k) {
+      r[k] = _mm_add_ps(
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[k][0], x), _mm_mul_ps(c[k][1], y)),
+                     _mm_mul_ps(c[k][2], z)),
+          c[k][3]);
+    }
+    __m128 rxy = _mm_shuffle_ps(r[0], r[1], _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 ryz = _mm_shuffle_ps(r[1], r[2], _MM_SHUFFLE(3, 1, 3, 1));
+    __m128 rzx = _mm_shuffle_ps(r[2], r[0], _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_ps(out, _mm_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  return done;
+}
+
+__attribute__((target("avx2,fma"))) size_t TransformAvx2(const Rows &m,
+                                                         const float *in,
+                                                         float *out,
+                                                         size_t count) {
+  __m256 c[3][4];
+  for (int r = 0; r < 3; ++r) {
+    for (int k = 0; k < 4; ++k) c[r][k] = _mm256_set1_ps(m[r][k]);
+  }
+  size_t done = 0;
+  for (; done + 8 <= count; done += 8, in += 24, out += 24) {
+    // в нижних дорожках точки 0-3, в верхних 4-7
+    __m256 m0 = _mm256_loadu2_m128(in + 12, in);
+    __m256 m1 = _mm256_loadu2_m128(in + 16, in + 4);
+    __m256 m2 = _mm256_loadu2_m128(in + 20, in + 8);
+    __m256 xy = _mm256_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+    __m256 yz = _mm256_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+    __m256 x = _mm256_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    __m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    __m256 z = _mm256_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+    __m256 r[3];
+    for (int k = 0; k < 3; ++k) {
+      r[k] = _mm256_fmadd_ps(
+          c[k][2], z,
+          _mm256_fmadd_ps(c[k][1], y, _mm256_fmadd_ps(c[k][0], x, c[k][3])));
+    }
+    __m256 rxy = _mm256_shuffle_ps(r[0], r[1], _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 ryz = _mm256_shuffle_ps(r[1], r[2], _MM_SHUFFLE(3, 1, 3, 1));
+    __m256 rzx = _mm256_shuffle_ps(r[2], r[0], _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu2_m128(out + 12, out,
+                        _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm256_storeu2_m128(out + 16, out + 4,
+                        _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu2_m128(out + 20, out + 8,
+                        _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  return done;
+}
+
+__attribute__((target("avx512f"))) __m512 Load4(const float *p) {
+  // дорожка k получает 4 float из p + 12 * k
+  __m512 v = _mm512_castps128_ps512(_mm_loadu_ps(p));
+  v = _mm512_insertf32x4(v, _mm_loadu_ps(p + 12), 1);
+  v = _mm512_insertf32x4(v, _mm_loadu_ps(p + 24), 2);
+  return _mm512_insertf32x4(v, _mm_loadu_ps(p + 36), 3);
+}
+
+__attribute__((target("avx512f"))) void Store4(float *p, __m512 v) {
+  // maskz: у _mm512_extractf32x4_ps в заголовках GCC неинициализированный
+  // источник, и без встраивания это даёт -Wmaybe-uninitialized
+  _mm_storeu_ps(p, _mm512_maskz_extractf32x4_ps(0xF, v, 0));
+  _mm_storeu_ps(p + 12, _mm512_maskz_extractf32x4_ps(0xF, v, 1));
+  _mm_storeu_ps(p + 24, _mm512_maskz_extractf32x4_ps(0xF, v, 2));
+  _mm_storeu_ps(p + 36, _mm512_maskz_extractf32x4_ps(0xF, v, 3));
+}
+
+__attribute__((target("avx512f"))) size_t TransformAvx512(const Rows &m,
+                                                          const float *in,
+                                                          float *out,
+                                                          size_t count) {
+  __m512 c[3][4];
+  for (int r = 0; r < 3; ++r) {
+    for (int k = 0; k < 4; ++k) c[r][k] = _mm512_set1_ps(m[r][k]);
+  }
+  size_t done = 0;
+  for (; done + 16 <= count; done += 16, in += 48, out += 48) {
+    __m512 m0 = Load4(in);
+    __m512 m1 = Load4(in + 4);
+    __m512 m2 = Load4(in + 8);
+    __m512 xy = _mm512_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+    __m512 yz = _mm512_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+    __m512 x = _mm512_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    __m512 y = _mm512_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    __m512 z = _mm512_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+    __m512 r[3];
+    for (int k = 0; k < 3; ++k) {
+      r[k] = _mm512_fmadd_ps(
+          c[k][2], z,
+          _mm512_fmadd_ps(c[k][1], y, _mm512_fmadd_ps(c[k][0], x, c[k][3])));
+    }
+    __m512 rxy = _mm512_shuffle_ps(r[0], r[1], _MM_SHUFFLE(2, 0, 2, 0));
+    __m512 ryz = _mm512_shuffle_ps(r[1], r[2], _MM_SHUFFLE(3, 1, 3, 1));
+    __m512 rzx = _mm512_shuffle_ps(r[2], r[0], _MM_SHUFFLE(3, 1, 2, 0));
+    Store4(out, _mm512_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0)));
+    Store4(out + 4, _mm512_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0)));
+    Store4(out + 8, _mm512_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+  return done;
+}
+#endif
+
+SimdLevel DetectSimdLevel() {
+#ifdef VIEWER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SimdLevel::kAvx512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SimdLevel::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) return SimdLevel::kSse;
+#endif
+  return SimdLevel::kScalar;
+}
+}  // namespace
+
+SimdLevel AffineMatrix::GetSimdLevel() {
+  static const SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+void AffineMatrix::TransformPoints(const float *in, float *out,
+                                      size_t count) const {
+  TransformPoints(in, out, count, GetSimdLevel());
+}
+
+void AffineMatrix::TransformPoints(const float *in, float *out,
+                                      size_t count, SimdLevel level) const {
+  const Rows &m = rows_;
+  size_t done = 0;
+#ifdef VIEWER_X86
+  switch (std::min(level, GetSimdLevel())) {
+    case SimdLevel::kAvx512:
+      done = TransformAvx512(m, in, out, count);
+      break;
+    case SimdLevel::kAvx2:
+      done = TransformAvx2(m, in, out, count);
+      break;
+    case SimdLevel::kSse:
+      done = TransformSse(m, in, out, count);
+      break;
+    default:
+      break;
+  }
+#else
+  (void)level;
+#endif
+  TransformScalar(m, in + done * 3, out + done * 3, count - done);
+}
@@ -0,0 +1,76 @@
+#include "model.h"
+using namespace viewer;
+
+namespace {
+thread_local bool inside_pool = false;
+}  // namespace
+
+WorkerPool::WorkerPool(unsigned threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(threads - 1);
+  for (unsigned i = 1; i < threads; ++i) {
+    workers_.emplace_back(&WorkerPool::WorkerLoop, this);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto &worker : workers_) worker.join();
+}
+
+WorkerPool &WorkerPool::Shared() {
+  static WorkerPool pool;
+  return pool;
+}
+
+void WorkerPool::Run(size_t count, const void *context, Body body) {
+  if (workers_.empty() || count < 2 || inside_pool) {
+    for (size_t i = 0; i < count; ++i) body(context, i);
+    return;
+  }
+  std::lock_guard<std::mutex> run(runMutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    context_ = context;
+    body_ = body;
+    count_ = count;
+    next_ = 0;
+    active_ = workers_.size();
+    ++generation_;
+  }
+  wake_.notify_all();
+  RunJob();
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return active_ == 0; });
+  context_ = nullptr;
+  body_ = nullptr;
+}
+
+void WorkerPool::RunJob() {
+  inside_pool = true;
+  size_t i;
+  while ((i = next_.fetch_add(1, std::memory_order_relaxed)) < count_) {
+    body_(context_, i);
+  }
+  inside_pool = false;
+}
+
+void WorkerPool::WorkerLoop() {
+  size_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+    if (stop_) return;
+    seen = generation_;
+    lock.unlock();
+    RunJob();
+    lock.lock();
+    if (--active_ == 0) done_.notify_one();
+  }
+}
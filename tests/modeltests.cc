@@ -1,11 +1,107 @@
+#include <fcntl.h>
 #include <gtest/gtest.h>
+#include <unistd.h>
+#include <zlib.h>
 
+#include <atomic>
 #include <cmath>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <set>
+#include <tuple>
 
 #include "../model/model.h"
 
 using namespace viewer;
 
+// Счётчик выделений памяти для проверки, что кадр ничего не копирует.
+// Считает во всех потоках, включая потоки WorkerPool, пока жив.
+class AllocationCounter {
+ public:
+  AllocationCounter() {
+    count_ = 0;
+    active_ = true;
+  }
+  ~AllocationCounter() { active_ = false; }
+  size_t GetCount() const { return count_; }
+  static void OnAllocate() {
+    if (active_) ++count_;
+  }
+
+ private:
+  static inline std::atomic<bool> active_ = false;
+  static inline std::atomic<size_t> count_ = 0;
+};
+
+// Замена всего набора operator new / delete. Выделение и освобождение
+// не встраиваются в место вызова, иначе GCC видит free для памяти из
+// new и предупреждает о несоответствии.
+namespace {
+[[gnu::noinline]] void *Allocate(size_t size, size_t alignment) {
+  AllocationCounter::OnAllocate();
+  if (size == 0) size = 1;
+  if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+  return std::aligned_alloc(alignment, (size + alignment - 1) /
+                                           alignment * alignment);
+}
+[[gnu::noinline]] void Deallocate(void *p) noexcept { std::free(p); }
+void *AllocateOrThrow(size_t size, size_t alignment) {
+  if (void *p = Allocate(size, alignment)) return p;
+  throw std::bad_alloc();
+}
+constexpr size_t kDefault = alignof(std::max_align_t);
+}  // namespace
+
+void *operator new(size_t size) { return AllocateOrThrow(size, kDefault); }
+void *operator new[](size_t size) { return AllocateOrThrow(size, kDefault); }
+void *operator new(size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, size_t(alignment));
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, size_t(alignment));
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size, kDefault);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return Allocate(size, kDefault);
+}
+void *operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return Allocate(size, size_t(alignment));
+}
+void *operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return Allocate(size, size_t(alignment));
+}
+void operator delete(void *p) noexcept { Deallocate(p); }
+void operator delete[](void *p) noexcept { Deallocate(p); }
+void operator delete(void *p, size_t) noexcept { Deallocate(p); }
+void operator delete[](void *p, size_t) noexcept { Deallocate(p); }
+void operator delete(void *p, std::align_val_t) noexcept { Deallocate(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { Deallocate(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  Deallocate(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  Deallocate(p);
+}
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  Deallocate(p);
+}
+
 // ------------------------- ThreeDPoint Tests ---------------------------
 
 TEST(ThreeDPointTest, Equality) {
@@ -95,22 +191,7 @@ TEST(VertexTest, GreaterOperator) {
 // --------------------------- Edge Tests -------------------------------
 
 TEST(EdgeTest, GreaterOperator) {
-  Vertex v1({1.0f, 0.0f, 0.0f});
-  Vertex v2({2.0f, 0.0f, 0.0f});
-  Vertex v3({3.0f, 0.0f, 0.0f});
-  Vertex v4({1.0f, 1.0f, 0.0f});
-
-  Edge e1, e2, e3, e4, e5;
-  e1.setBegin(&v1);
-  e1.setEnd(&v2);
-  e2.setBegin(&v2);
-  e2.setEnd(&v3);
-  e3.setBegin(&v1);
-  e3.setEnd(&v3);
-  e4.setBegin(&v1);
-  e4.setEnd(&v4);
-  e5.setBegin(&v1);
-  e5.setEnd(&v2);
+  Edge e1(0, 1), e2(1, 2), e3(0, 2), e4(0, 0), e5(0, 1);
 
   EXPECT_TRUE(e2 > e1);
   EXPECT_FALSE(e1 > e2);
@@ -120,43 +201,60 @@ TEST(EdgeTest, GreaterOperator) {
   EXPECT_TRUE(e1 > e4);
   EXPECT_FALSE(e1 > e5);
   EXPECT_FALSE(e5 > e1);
-
-  Vertex v5({4.0f, 0.0f, 0.0f});
-  Vertex v6({0.0f, 0.0f, 0.0f});
-  Edge e6, e7;
-  e6.setBegin(&v5);
-  e6.setEnd(&v6);
-  e7.setBegin(&v1);
-  e7.setEnd(&v3);
-
-  EXPECT_TRUE(e6 > e7);
 }
 
 TEST(EdgeTest, VertexLinking) {
-  Vertex v1({0, 0, 0}), v2({1, 1, 1});
   Edge e;
-  e.setBegin(&v1);
-  e.setEnd(&v2);
+  e.setBegin(3);
+  e.setEnd(7);
 
-  EXPECT_EQ(e.GetBegin(), &v1);
-  EXPECT_EQ(e.GetEnd(), &v2);
+  EXPECT_EQ(e.GetBegin(), 3);
+  EXPECT_EQ(e.GetEnd(), 7);
+  EXPECT_EQ(e, Edge(3, 7));
 }
 
 TEST(EdgeTest, Comparison) {
-  Vertex v1({0, 0, 0}), v2({1, 0, 0}), v3({0, 1, 0});
-  Edge e1, e2, e3;
-  e1.setBegin(&v1);
-  e1.setEnd(&v2);
-  e2.setBegin(&v1);
-  e2.setEnd(&v3);
-  e3.setBegin(&v2);
-  e3.setEnd(&v3);
+  Edge e1(0, 1), e2(0, 2), e3(1, 2);
 
   EXPECT_TRUE(e1 < e3);
   EXPECT_TRUE(e2 < e3);
   EXPECT_FALSE(e1 == e2);
 }
 
+TEST(EdgeIndexSetTest, DeduplicatesUnorderedPairs) {
+  EdgeIndexSet edges;
+  EXPECT_TRUE(edges.Insert(3, 1));
+  EXPECT_FALSE(edges.Insert(1, 3));
+  EXPECT_TRUE(edges.Insert(2, 2));
+  for (uint32_t i = 0; i < 1000; ++i) {
+    edges.Insert(i, i + 1);
+  }
+  for (uint32_t i = 0; i < 1000; ++i) {
+    EXPECT_FALSE(edges.Insert(i + 1, i));
+  }
+
+  ASSERT_EQ(edges.GetSize(), 1002);
+  EXPECT_EQ(edges.GetKeys()[0], EdgeIndexSet::MakeKey(1, 3));
+  EXPECT_EQ(edges.GetKeys()[1], EdgeIndexSet::MakeKey(2, 2));
+  EXPECT_EQ(edges.GetKeys()[2], EdgeIndexSet::MakeKey(0, 1));
+}
+
+// ------------------------- WorkerPool Tests ----------------------------
+
+TEST(WorkerPoolTest, VisitsEveryIndexOnce) {
+  WorkerPool pool(4);
+  EXPECT_EQ(pool.GetThreadCount(), 4);
+  for (size_t count : {0, 1, 3, 1000}) {
+    std::vector<std::atomic<int>> visits(count);
+    pool.ParallelFor(count, [&](size_t i) {
+      visits[i]++;
+      // вложенный цикл выполняется в том же потоке
+      pool.ParallelFor(2, [&](size_t) {});
+    });
+    for (auto &v : visits) EXPECT_EQ(v.load(), 1);
+  }
+}
+
 // ---------------------- TransformMatrix Tests --------------------------
 
 TEST(TransformMatrixTest, Multiplication) {
@@ -180,6 +278,77 @@ TEST(TransformMatrixTest, PointTransformation) {
   EXPECT_FLOAT_EQ(res.y, 2.0f);
 }
 
+TEST(AffineMatrixTest, ComposesAtCompileTime) {
+  constexpr AffineMatrix m = AffineMatrix::Translation(1, 2, 3) *
+                             AffineMatrix::Scaling(2, 2, 2);
+  constexpr ThreeDPoint p = m.TransformPoint(ThreeDPoint(1, 1, 1));
+  static_assert(p.x == 3 && p.y == 4 && p.z == 5);
+  static_assert(m.Get(0, 0) == 2 && m.Get(2, 3) == 3);
+}
+
+TEST(AffineMatrixTest, ClosedFormTrsMatchesProduct) {
+  array<float, 3> move = {1.5, -2, 3}, rotate = {30, -75, 140},
+                  scale = {2, 0.5, 3};
+  AffineMatrix product =
+      AffineMatrix::Translation(move[0], move[1], move[2]) *
+      AffineMatrix::Rotation(0, 0, rotate[2]) *
+      AffineMatrix::Rotation(0, rotate[1], 0) *
+      AffineMatrix::Rotation(rotate[0], 0, 0) *
+      AffineMatrix::Scaling(scale[0], scale[1], scale[2]);
+  AffineMatrix trs = AffineMatrix::FromTrs(move, rotate, scale);
+  TransformMatrix full(trs);
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      EXPECT_NEAR(trs.Get(r, c), product.Get(r, c), 1e-5) << r << c;
+      EXPECT_EQ(full.getMatrixElement(r, c), trs.Get(r, c));
+    }
+  }
+  EXPECT_EQ(full.getMatrixElement(3, 3), 1.0f);
+
+  ThreeDPoint p = AffineMatrix::Rotation(0, 0, 90).TransformPoint(
+      ThreeDPoint(1, 0, 0));
+  EXPECT_NEAR(p.x, 0, 1e-6);
+  EXPECT_NEAR(p.y, 1, 1e-6);
+}
+
+TEST(AffineMatrixTest, SimdKernelsMatchScalar) {
+  AffineMatrix m = AffineMatrix::FromTrs({1.5, -2, 3}, {0.3, 1.1, -0.7},
+                                         {2, 0.5, 3});
+  // 37 точек: полные пачки каждой ширины и хвост
+  const size_t count = 37;
+  vector<float> in(count * 3);
+  for (size_t i = 0; i < in.size(); ++i) {
+    in[i] = std::sin(i * 0.77f) * 100.0f;
+  }
+  vector<float> expected(in.size());
+  m.TransformPoints(in.data(), expected.data(), count, SimdLevel::kScalar);
+  for (size_t i = 0; i < count; ++i) {
+    ThreeDPoint p = m.TransformPoint(
+        ThreeDPoint(in[i * 3], in[i * 3 + 1], in[i * 3 + 2]));
+    EXPECT_EQ(expected[i * 3], p.x);
+    EXPECT_EQ(expected[i * 3 + 1], p.y);
+    EXPECT_EQ(expected[i * 3 + 2], p.z);
+  }
+
+  for (SimdLevel level : {SimdLevel::kSse, SimdLevel::kAvx2,
+                          SimdLevel::kAvx512}) {
+    vector<float> out = in;
+    // на месте, как при повторном преобразовании буфера
+    m.TransformPoints(out.data(), out.data(), count, level);
+    for (size_t i = 0; i < count; ++i) {
+      for (int r = 0; r < 3; ++r) {
+        float bound = std::abs(m.Get(r, 3));
+        for (int c = 0; c < 3; ++c) {
+          bound += std::abs(m.Get(r, c) * in[i * 3 + c]);
+        }
+        EXPECT_NEAR(out[i * 3 + r], expected[i * 3 + r],
+                    bound * std::ldexp(1.0f, -20))
+            << "level " << int(level) << " point " << i;
+      }
+    }
+  }
+}
+
 // ------------------ TransformMatrixBuilder Tests -----------------------
 
 TEST(TransformMatrixBuilderTest, TranslationMatrix) {
@@ -206,11 +375,12 @@ TEST(TransformMatrixBuilderTest, RotationMatrixX) {
 
 TEST(FigureTest, AddVertex) {
   Figure fig;
-  auto v = std::make_shared<Vertex>(ThreeDPoint(1, 2, 3));
-  fig.setVertices(v);
+  fig.AddVertex(ThreeDPoint(1, 2, 3));
 
-  EXPECT_EQ(fig.GetVertices().size(), 1);
-  EXPECT_EQ(fig.GetVertices()[0]->GetPosition(), ThreeDPoint(1, 2, 3));
+  EXPECT_EQ(fig.GetVertexCount(), 1);
+  EXPECT_EQ(fig.GetVertex(0), ThreeDPoint(1, 2, 3));
+  EXPECT_EQ(fig.GetDataVertex(0), ThreeDPoint(1, 2, 3));
+  EXPECT_EQ(fig.GetPositions(), (vector<float>{1, 2, 3}));
 }
 
 TEST(FigureTest, TransformationOrder) {
@@ -219,18 +389,576 @@ TEST(FigureTest, TransformationOrder) {
   fig.setMove(5.0f, 0.0f, 0.0f);
   fig.setRotate(0.0f, 90.0f, 0.0f);
 
-  auto v = std::make_shared<Vertex>(ThreeDPoint(1, 0, 0));
-  fig.setVertices(v);
-  fig.setDataVertices(v->GetPosition());
+  fig.AddVertex(ThreeDPoint(1, 0, 0));
 
   fig.Transform();
 
-  ThreeDPoint res = fig.GetVertices()[0]->GetPosition();
+  ThreeDPoint res = fig.GetVertex(0);
   EXPECT_NEAR(res.x, 5.0f, 1e-5);
   EXPECT_NEAR(res.y, 0.0f, 1e-5);
   EXPECT_NEAR(res.z, -2.0f, 1e-5);
 }
 
+TEST(FigureTest, SceneTransformsEveryFigure) {
+  Scene scene;
+  for (int i = 0; i < 8; ++i) {
+    auto fig = std::make_shared<Figure>();
+    fig->AddVertex(ThreeDPoint(i, 0, 0));
+    fig->setMove(0, i, 0);
+    scene.setFigures(fig);
+  }
+  scene.Transform();
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(scene.GetFigures()[i]->GetVertex(0), ThreeDPoint(i, i, 0));
+  }
+}
+
+TEST(FigureTest, SceneTransformsOnlyDirtyFigures) {
+  Scene scene;
+  auto moved = std::make_shared<Figure>();
+  auto still = std::make_shared<Figure>();
+  moved->AddVertex(ThreeDPoint(1, 0, 0));
+  still->AddVertex(ThreeDPoint(2, 0, 0));
+  scene.setFigures(moved);
+  scene.setFigures(still);
+  EXPECT_FALSE(scene.Transform());
+
+  // несколько событий ввода до кадра - один пересчёт с последними
+  // параметрами
+  moved->setMove(5, 0, 0);
+  moved->setMove(0, 3, 0);
+  still->setScale(1);
+  EXPECT_TRUE(moved->IsTransformDirty());
+  EXPECT_FALSE(still->IsTransformDirty());
+  EXPECT_TRUE(scene.Transform());
+  EXPECT_FALSE(moved->IsTransformDirty());
+  EXPECT_EQ(moved->GetVertex(0), ThreeDPoint(1, 3, 0));
+  EXPECT_FALSE(scene.Transform());
+
+  // поза не перестраивается ради новых вершин
+  moved->AddVertex(ThreeDPoint(0, 0, 0));
+  EXPECT_FALSE(moved->IsTransformDirty());
+  EXPECT_EQ(moved->GetVertex(1), ThreeDPoint(0, 3, 0));
+}
+
+TEST(FigureTest, TransformKeepsPositions) {
+  vector<float> positions = {1, 2, 3, -4, 5, -6};
+  Figure fig;
+  fig.setPositions(positions);
+  const float *data = fig.GetPositions().data();
+  fig.setRotate(0.5, -0.25, 1);
+  fig.setMove(3, 0, -1);
+  fig.Transform();
+
+  // поза попадает только в матрицу модели
+  EXPECT_EQ(fig.GetPositions(), positions);
+  EXPECT_EQ(fig.GetPositions().data(), data);
+  AffineMatrix m = AffineMatrix::FromTrs({3, 0, -1}, {0.5, -0.25, 1},
+                                         {1, 1, 1});
+  array<float, 16> columns = fig.GetModelMatrix().GetColumnMajor();
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      EXPECT_EQ(columns[c * 4 + r], m.Get(r, c));
+    }
+  }
+  EXPECT_EQ(columns[15], 1);
+  EXPECT_EQ(fig.GetVertex(1), m.TransformPoint(fig.GetDataVertex(1)));
+}
+
+TEST(FigureTest, QuantizedPositions) {
+  auto fig = std::make_shared<Figure>();
+  vector<float> positions;
+  for (int i = 0; i < 1000; ++i) {
+    positions.insert(positions.end(),
+                     {std::sin(i * 0.1f), std::cos(i * 0.3f) * 5, i * 0.01f});
+  }
+  fig->setPositions(positions);
+  fig->setMove(1, 2, 3);
+  fig->Transform();
+  Scene scene;
+  scene.setFigures(fig);
+  float error = scene.Quantize();
+
+  ASSERT_TRUE(fig->IsQuantized());
+  EXPECT_TRUE(fig->GetPositions().empty());
+  EXPECT_EQ(fig->GetVertexCount(), 1000);
+  EXPECT_EQ(fig->GetMemoryUsage().vertices, 1000 * 3 * sizeof(int16_t));
+  EXPECT_EQ(scene.GetQuantizationError(), error);
+  // половина шага сетки по самой длинной оси (z: 0..9.99)
+  EXPECT_GT(error, 0);
+  EXPECT_LE(error, 9.99f / 65534 / 2 * 1.01f);
+  float worst = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    ThreeDPoint data = fig->GetDataVertex(i);
+    ThreeDPoint posed = fig->GetVertex(i);
+    worst = std::max({worst, std::abs(data.x - positions[i * 3]),
+                      std::abs(data.y - positions[i * 3 + 1]),
+                      std::abs(data.z - positions[i * 3 + 2])});
+    EXPECT_NEAR(posed.y, positions[i * 3 + 1] + 2, 1e-3);
+  }
+  EXPECT_NEAR(worst, error, 1e-6);
+
+  // добавление вершины возвращает фигуру к float
+  fig->AddVertex(ThreeDPoint(7, 7, 7));
+  EXPECT_FALSE(fig->IsQuantized());
+  EXPECT_EQ(fig->GetVertexCount(), 1001);
+  // пакетное восстановление с FMA отличается от скалярного на единицы
+  // младшего разряда
+  for (size_t i = 0; i < 1000; ++i) {
+    ThreeDPoint data = fig->GetDataVertex(i);
+    EXPECT_NEAR(data.x, positions[i * 3], error + 1e-6);
+    EXPECT_NEAR(data.y, positions[i * 3 + 1], error + 1e-6);
+    EXPECT_NEAR(data.z, positions[i * 3 + 2], error + 1e-6);
+  }
+  EXPECT_EQ(fig->GetVertex(1000), ThreeDPoint(8, 9, 10));
+}
+
+TEST(FigureTest, EdgeIndexWidthFollowsVertexCount) {
+  Figure fig;
+  fig.AddEdge(0, 1);
+  EXPECT_EQ(fig.GetIndexSize(), 2);
+  fig.AddEdge(1, 70000);
+  EXPECT_EQ(fig.GetIndexSize(), 4);
+  fig.AddEdge(5000000000ull, 2);
+  EXPECT_EQ(fig.GetIndexSize(), 8);
+  ASSERT_EQ(fig.GetEdgeCount(), 3);
+  EXPECT_EQ(fig.GetEdge(0), Edge64(0, 1));
+  EXPECT_EQ(fig.GetEdge(1), Edge64(1, 70000));
+  EXPECT_EQ(fig.GetEdge(2), Edge64(5000000000ull, 2));
+  // VboSceneDrawer выбирает по GetIndexSize, загружать ли рёбра в
+  // индексный буфер: ширина и тип хранимого массива должны совпадать
+  fig.VisitEdges([&](const auto &edges) {
+    EXPECT_EQ(sizeof(edges[0]), 2 * fig.GetIndexSize());
+    EXPECT_EQ(edges.size(), 3);
+  });
+  Figure narrow;
+  narrow.setEdges(vector<Edge>{Edge(0, 70000)});
+  EXPECT_EQ(narrow.GetIndexSize(), 4);
+  narrow.VisitEdges([&](const auto &edges) {
+    EXPECT_EQ(sizeof(edges[0]), 2 * narrow.GetIndexSize());
+  });
+
+  EXPECT_EQ(DispatchIndexWidth(65536, [](auto index) { return sizeof(index); }),
+            2);
+  EXPECT_EQ(DispatchIndexWidth(65537, [](auto index) { return sizeof(index); }),
+            4);
+}
+
+TEST(FigureTest, FrameDoesNotAllocate) {
+  Scene scene;
+  for (int f = 0; f < 3; ++f) {
+    auto fig = std::make_shared<Figure>();
+    for (int i = 0; i < 100; ++i) fig->AddVertex(ThreeDPoint(i, f, 0));
+    for (int i = 0; i + 1 < 100; ++i) fig->AddEdge(i, i + 1);
+    scene.setFigures(fig);
+  }
+  scene.GetFigures()[1]->Quantize(NormalizationParameters{0, 99, 0, 2, 0, 0});
+  // фигура, у которой есть уровни детализации
+  auto grid = std::make_shared<Figure>();
+  const int n = 200;
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) grid->AddVertex(ThreeDPoint(x, y, 0));
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x + 1 < n; ++x) {
+      grid->AddEdge(y * n + x, y * n + x + 1);
+      grid->AddEdge(x * n + y, (x + 1) * n + y);
+    }
+  }
+  scene.setFigures(grid);
+  scene.BuildClusters();
+  // больше 64 кластеров, чтобы отсечение шло блоками в потоках пула
+  grid->BuildClusters(256);
+  scene.BuildLods();
+  ASSERT_FALSE(grid->GetLods().empty());
+  // сетка на экране около 25 пикселей
+  const array<float, 16> projection = {2e-4f, 0, 0,     0, 0, 2e-4f, 0, 0,
+                                       0,     0, 2e-4f, 0, 0, 0,     0, 1};
+  const array<float, 16> identity = {1, 0, 0, 0, 0, 1, 0, 0,
+                                     0, 0, 1, 0, 0, 0, 0, 1};
+  const Frustum frustum(projection, identity);
+  vector<size_t> levels(scene.GetFigures().size());
+  vector<IndexRange> visible;
+  // как SceneDrawerBase::VisibleRanges
+  auto cull = [&](std::span<const Cluster> clusters, size_t count,
+                  const AffineMatrix &model) {
+    if (clusters.empty()) {
+      visible.assign(1, IndexRange{0, count});
+    } else {
+      CullClusters(clusters, frustum.Transformed(model), visible,
+                   WorkerPool::Shared());
+    }
+    for (IndexRange range : visible) count -= range.end - range.begin;
+    return count;
+  };
+
+  // то, что делают за кадр отрисовка, подсчёт размеров и запись
+  double checksum = 0;
+  size_t vertices = 0, edges = 0, culled = 0;
+  auto frame = [&](int number) {
+    for (const auto &figure : scene.GetFigures()) {
+      figure->setRotate(number, 0, 0);
+    }
+    scene.Transform();
+    for (size_t i = 0; i < levels.size(); ++i) {
+      const Figure &figure = *scene.GetFigures()[i];
+      levels[i] = figure.SelectLod(projection, identity, 1280, 720,
+                                   levels[i]);
+      const Figure &drawn =
+          levels[i] == 0 ? figure : *figure.GetLods()[levels[i] - 1].figure;
+      // собственные кластеры фигуры - как при увеличении
+      culled += cull(figure.GetEdgeClusters(), figure.GetEdgeCount(),
+                     figure.GetModelMatrix());
+      culled += cull(drawn.GetEdgeClusters(), drawn.GetEdgeCount(),
+                     figure.GetModelMatrix());
+      culled += cull(drawn.GetVertexClusters(), drawn.GetVertexCount(),
+                     figure.GetModelMatrix());
+    }
+    for (const auto &figure : scene.GetFigures()) {
+      vertices += figure->GetVertexCount();
+      edges += figure->GetEdgeCount();
+      checksum += figure->GetModelMatrix().GetColumnMajor()[0];
+      figure->VisitPositions([&](auto positions) {
+        figure->VisitEdges([&](auto span) {
+          for (const auto &edge : span) {
+            checksum += positions[edge.GetBegin() * 3];
+          }
+        });
+      });
+    }
+    checksum += scene.GetMemoryUsage().Total();
+  };
+  // первый кадр заводит буферы отсечения, которые потом переиспользуются
+  frame(0);
+  vertices = edges = 0;
+  AllocationCounter allocations;
+  for (int number = 0; number < 10; ++number) frame(number);
+  EXPECT_EQ(allocations.GetCount(), 0);
+  EXPECT_EQ(culled, 0);
+  EXPECT_EQ(vertices, 10 * (300 + n * n));
+  EXPECT_EQ(edges, 10 * (297 + 2 * n * (n - 1)));
+  EXPECT_NE(levels.back(), 0);
+  EXPECT_NE(checksum, 0);
+}
+
+TEST(FigureTest, GeometryVersionIgnoresPose) {
+  Figure figure;
+  uint64_t version = figure.GetGeometryVersion();
+  figure.AddVertex(ThreeDPoint(0, 0, 0));
+  figure.AddVertex(ThreeDPoint(1, 0, 0));
+  EXPECT_GT(figure.GetGeometryVersion(), version);
+  version = figure.GetGeometryVersion();
+  figure.AddEdge(0, 1);
+  EXPECT_GT(figure.GetGeometryVersion(), version);
+
+  version = figure.GetGeometryVersion();
+  figure.setRotate(10, 20, 30);
+  figure.setScale(2);
+  figure.Transform();
+  EXPECT_EQ(figure.GetGeometryVersion(), version);
+
+  figure.Quantize(NormalizationParameters{0, 1, 0, 0, 0, 0});
+  EXPECT_GT(figure.GetGeometryVersion(), version);
+}
+
+TEST(FigureTest, DirtyRangesCoverChangesSinceClear) {
+  Figure figure;
+  for (int i = 0; i < 10; ++i) figure.AddVertex(ThreeDPoint(i, 0, 0));
+  for (int i = 0; i + 1 < 10; ++i) figure.AddEdge(i, i + 1);
+  EXPECT_EQ(figure.GetDirtyVertices().end, 10);
+  figure.ClearDirtyRanges();
+  EXPECT_EQ(figure.GetDirtyBaseVersion(), figure.GetGeometryVersion());
+  EXPECT_TRUE(figure.GetDirtyVertices().IsEmpty());
+
+  figure.AddVertex(ThreeDPoint(10, 0, 0));
+  figure.AddVertex(ThreeDPoint(11, 0, 0));
+  figure.AddEdge(10, 11);
+  EXPECT_EQ(figure.GetDirtyVertices().begin, 10);
+  EXPECT_EQ(figure.GetDirtyVertices().end, 12);
+  EXPECT_EQ(figure.GetDirtyEdges().begin, 9);
+  EXPECT_EQ(figure.GetDirtyEdges().end, 10);
+
+  // смена ширины номеров переписывает все рёбра
+  figure.ClearDirtyRanges();
+  figure.AddEdge(0, 70000);
+  EXPECT_EQ(figure.GetDirtyEdges().begin, 0);
+  EXPECT_EQ(figure.GetDirtyEdges().end, 11);
+  EXPECT_TRUE(figure.GetDirtyVertices().IsEmpty());
+
+  figure.ClearDirtyRanges();
+  figure.setRotate(0, 90, 0);
+  figure.Transform();
+  EXPECT_EQ(figure.GetDirtyBaseVersion(), figure.GetGeometryVersion());
+}
+
+TEST(FigureTest, StripsCoverEveryEdgeOnce) {
+  // сетка 256 x 256: 65536 вершин, номер 65535 занят вершиной, поэтому
+  // ломаным нужны 32-битные номера
+  const int n = 256;
+  Figure figure;
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) figure.AddVertex(ThreeDPoint(x, y, 0));
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      if (x + 1 < n) figure.AddEdge(y * n + x, y * n + x + 1);
+      if (y + 1 < n) figure.AddEdge(y * n + x, (y + 1) * n + x);
+    }
+  }
+  EXPECT_EQ(figure.GetIndexSize(), 2);
+  figure.BuildStrips();
+  ASSERT_TRUE(figure.HasStrips());
+
+  std::set<std::pair<uint64_t, uint64_t>> edges;
+  size_t submitted = figure.VisitStrips([&](auto strips) {
+    using Index = typename decltype(strips)::value_type;
+    EXPECT_EQ(sizeof(Index), 4);
+    constexpr Index kRestart = std::numeric_limits<Index>::max();
+    for (size_t i = 0; i + 1 < strips.size(); ++i) {
+      if (strips[i] == kRestart || strips[i + 1] == kRestart) continue;
+      uint64_t a = strips[i];
+      uint64_t b = strips[i + 1];
+      EXPECT_TRUE(edges.insert({std::min(a, b), std::max(a, b)}).second);
+    }
+    return strips.size();
+  });
+  EXPECT_EQ(edges.size(), figure.GetEdgeCount());
+  for (size_t i = 0; i < figure.GetEdgeCount(); ++i) {
+    uint64_t a = figure.GetEdge(i).GetBegin();
+    uint64_t b = figure.GetEdge(i).GetEnd();
+    EXPECT_TRUE(edges.count({std::min(a, b), std::max(a, b)}));
+  }
+  // вершин передаётся почти вдвое меньше, чем парами
+  EXPECT_LT(submitted, figure.GetEdgeCount() * 2 * 0.55);
+
+  figure.AddEdge(0, n + 1);
+  EXPECT_FALSE(figure.HasStrips());
+}
+
+// Ортографическая проекция куба [-1, 1]^3 и единичный вид.
+constexpr array<float, 16> kIdentity = {1, 0, 0, 0, 0, 1, 0, 0,
+                                        0, 0, 1, 0, 0, 0, 0, 1};
+
+NormalizationParameters Box(float min, float max) {
+  NormalizationParameters box;
+  box.minX = box.minY = box.minZ = min;
+  box.maxX = box.maxY = box.maxZ = max;
+  return box;
+}
+
+TEST(FrustumTest, SeparatesBoxesByPlanes) {
+  Frustum frustum(kIdentity, kIdentity);
+  EXPECT_TRUE(frustum.Intersects(Box(-0.5, 0.5)));
+  EXPECT_TRUE(frustum.Intersects(Box(0.9, 3)));
+  EXPECT_FALSE(frustum.Intersects(Box(1.5, 3)));
+  EXPECT_FALSE(frustum.Intersects(Box(-3, -1.5)));
+
+  // фигура сдвинута на 2 по x: её точка x = -2 видна в начале координат
+  Frustum moved = frustum.Transformed(AffineMatrix::Translation(2, 0, 0));
+  NormalizationParameters box = Box(-0.5, 0.5);
+  EXPECT_FALSE(moved.Intersects(box));
+  box.minX = -2.5;
+  box.maxX = -1.5;
+  EXPECT_TRUE(moved.Intersects(box));
+}
+
+TEST(FrustumTest, CullingMergesAdjacentClusters) {
+  vector<Cluster> clusters;
+  const float centers[] = {0, 0.5, 5, 5, -0.5, 7};
+  for (size_t i = 0; i < std::size(centers); ++i) {
+    clusters.push_back({{i * 10, i * 10 + 10},
+                        Box(centers[i] - 0.1f, centers[i] + 0.1f)});
+  }
+  vector<IndexRange> visible;
+  CullClusters(clusters, Frustum(kIdentity, kIdentity), visible,
+               WorkerPool::Shared());
+  ASSERT_EQ(visible.size(), 2);
+  EXPECT_EQ(visible[0].begin, 0);
+  EXPECT_EQ(visible[0].end, 20);
+  EXPECT_EQ(visible[1].begin, 40);
+  EXPECT_EQ(visible[1].end, 50);
+}
+
+TEST(FigureTest, ClustersKeepGeometryAndBoundIt) {
+  const int n = 40;
+  Figure figure;
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) figure.AddVertex(ThreeDPoint(x, y, x % 3));
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x + 1 < n; ++x) figure.AddEdge(y * n + x, y * n + x + 1);
+  }
+  using Segment = std::pair<std::tuple<float, float, float>,
+                            std::tuple<float, float, float>>;
+  auto segments = [&figure] {
+    std::multiset<Segment> result;
+    for (size_t i = 0; i < figure.GetEdgeCount(); ++i) {
+      ThreeDPoint a = figure.GetVertex(figure.GetEdge(i).GetBegin());
+      ThreeDPoint b = figure.GetVertex(figure.GetEdge(i).GetEnd());
+      auto pa = std::make_tuple(a.x, a.y, a.z);
+      auto pb = std::make_tuple(b.x, b.y, b.z);
+      result.insert(std::minmax(pa, pb));
+    }
+    return result;
+  };
+  std::multiset<Segment> before = segments();
+  uint64_t version = figure.GetGeometryVersion();
+
+  figure.BuildClusters(100);
+  EXPECT_EQ(segments(), before);
+  EXPECT_NE(figure.GetGeometryVersion(), version);
+  ASSERT_EQ(figure.GetVertexClusters().size(), 16);
+  ASSERT_EQ(figure.GetEdgeClusters().size(), 16);
+  EXPECT_EQ(figure.GetEdgeClusters().back().range.end,
+            figure.GetEdgeCount());
+
+  auto inside = [](const ThreeDPoint &p, const NormalizationParameters &b) {
+    return p.x >= b.minX && p.x <= b.maxX && p.y >= b.minY &&
+           p.y <= b.maxY && p.z >= b.minZ && p.z <= b.maxZ;
+  };
+  for (const Cluster &cluster : figure.GetEdgeClusters()) {
+    for (size_t e = cluster.range.begin; e < cluster.range.end; ++e) {
+      Edge64 edge = figure.GetEdge(e);
+      EXPECT_TRUE(inside(figure.GetVertex(edge.GetBegin()), cluster.bounds));
+      EXPECT_TRUE(inside(figure.GetVertex(edge.GetEnd()), cluster.bounds));
+    }
+  }
+  for (const Cluster &cluster : figure.GetVertexClusters()) {
+    for (size_t v = cluster.range.begin; v < cluster.range.end; ++v) {
+      EXPECT_TRUE(inside(figure.GetVertex(v), cluster.bounds));
+    }
+  }
+
+  figure.AddVertex(ThreeDPoint(0, 0, 0));
+  EXPECT_TRUE(figure.GetVertexClusters().empty());
+  EXPECT_TRUE(figure.GetEdgeClusters().empty());
+}
+
+// Сетка n x n с шагом 1 и рёбрами по строкам и столбцам.
+Figure MakeGrid(int n) {
+  Figure figure;
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) figure.AddVertex(ThreeDPoint(x, y, 0));
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      if (x + 1 < n) figure.AddEdge(y * n + x, y * n + x + 1);
+      if (y + 1 < n) figure.AddEdge(y * n + x, (y + 1) * n + x);
+    }
+  }
+  return figure;
+}
+
+TEST(FigureTest, LodsHalveEdgesAndStayInBounds) {
+  Figure figure = MakeGrid(300);
+  figure.BuildLods();
+  std::span<const LodLevel> lods = figure.GetLods();
+  ASSERT_GE(lods.size(), 3);
+  size_t edges = figure.GetEdgeCount();
+  float cell = 0;
+  for (const LodLevel &lod : lods) {
+    EXPECT_LE(lod.figure->GetEdgeCount() * 2, edges);
+    EXPECT_GT(lod.figure->GetEdgeCount(), 0);
+    EXPECT_GT(lod.cellSize, cell);
+    edges = lod.figure->GetEdgeCount();
+    cell = lod.cellSize;
+    for (size_t v = 0; v < lod.figure->GetVertexCount(); ++v) {
+      ThreeDPoint p = lod.figure->GetVertex(v);
+      EXPECT_TRUE(p.x >= 0 && p.x <= 299 && p.y >= 0 && p.y <= 299);
+      EXPECT_EQ(p.z, 0);
+    }
+  }
+
+  figure.AddEdge(0, 301);
+  EXPECT_TRUE(figure.GetLods().empty());
+  Figure small = MakeGrid(100);
+  small.BuildLods();
+  EXPECT_TRUE(small.GetLods().empty());
+}
+
+TEST(FigureTest, QuantizedLodsShareDequantization) {
+  Scene scene;
+  scene.setFigures(std::make_shared<Figure>(MakeGrid(200)));
+  scene.Quantize();
+  scene.BuildLods();
+  const Figure &figure = *scene.GetFigures()[0];
+  ASSERT_FALSE(figure.GetLods().empty());
+  const Figure &lod = *figure.GetLods().back().figure;
+  EXPECT_TRUE(lod.IsQuantized());
+  for (size_t v = 0; v < lod.GetVertexCount(); ++v) {
+    ThreeDPoint p = lod.GetVertex(v);
+    EXPECT_TRUE(p.x >= -0.01 && p.x <= 199.01 && p.y >= -0.01 &&
+                p.y <= 199.01);
+  }
+}
+
+TEST(FigureTest, LodSelectionFollowsScaleWithHysteresis) {
+  Figure figure = MakeGrid(300);
+  figure.BuildLods();
+  size_t count = figure.GetLods().size();
+  ASSERT_GE(count, 2);
+  // единичные матрицы: единица хранения занимает width / 2 пикселей
+  auto select = [&](float pixels_per_unit, size_t current) {
+    return figure.SelectLod(kIdentity, kIdentity, pixels_per_unit * 2,
+                            pixels_per_unit * 2, current);
+  };
+  EXPECT_EQ(select(1000, count), 0);
+  EXPECT_EQ(select(0.001f, 0), count);
+
+  // ячейка уровня 1 на экране чуть больше пикселя: уровень 1 держится,
+  // но с уровня 0 на него не переходят
+  float cell = figure.GetLods()[0].cellSize;
+  float scale = Figure::kLodPixels * 1.1f / cell;
+  EXPECT_EQ(select(scale, 1), 1);
+  EXPECT_EQ(select(scale, 0), 0);
+  EXPECT_EQ(select(scale, count), 1);
+  // выбор устойчив: повторный вызов с тем же масштабом его не меняет
+  for (size_t current = 0; current <= count; ++current) {
+    size_t level = select(0.05f, current);
+    EXPECT_EQ(select(0.05f, level), level);
+  }
+}
+
+static_assert(!std::is_copy_constructible_v<Scene>);
+static_assert(!std::is_copy_assignable_v<Scene>);
+static_assert(std::is_nothrow_move_constructible_v<Scene>);
+
+TEST(FigureTest, SceneHandOffDoesNotCopyGeometry) {
+  Scene scene;
+  auto fig = std::make_shared<Figure>();
+  for (int i = 0; i < 1000; ++i) fig->AddVertex(ThreeDPoint(i, 0, 0));
+  for (int i = 0; i + 1 < 1000; ++i) fig->AddEdge(i, i + 1);
+  scene.setFigures(fig);
+  const float *positions = fig->GetPositions().data();
+
+  // путь сцены от читателя к фасаду и виду
+  std::shared_ptr<const Scene> view;
+  size_t allocated;
+  {
+    AllocationCounter allocations;
+    auto shared = std::make_shared<Scene>(std::move(scene));
+    view = shared;
+    allocated = allocations.GetCount();
+  }
+  EXPECT_EQ(allocated, 1);  // блок shared_ptr со сценой
+  ASSERT_EQ(view->GetFigures().size(), 1);
+  EXPECT_EQ(view->GetFigures()[0]->GetPositions().data(), positions);
+  EXPECT_TRUE(scene.GetFigures().empty());
+}
+
+TEST(FigureTest, MemoryUsage) {
+  Figure fig;
+  EXPECT_EQ(fig.GetMemoryUsage().Total(), 0);
+
+  fig.setPositions({0, 0, 0, 1, 0, 0});
+  fig.setEdges(vector<Edge16>{Edge16(0, 1)});
+
+  MemoryUsage usage = fig.GetMemoryUsage();
+  EXPECT_EQ(usage.vertices, 6 * sizeof(float));
+  EXPECT_EQ(usage.edges, sizeof(Edge16));
+  EXPECT_EQ(usage.Total(), usage.vertices + usage.edges);
+}
+
 // ------------------------ FileReader Tests ----------------------------
 
 TEST(FileReaderTest, VertexParsing) {
@@ -243,13 +971,13 @@ TEST(FileReaderTest, VertexParsing) {
   Scene scene = FileReader().ReadScene("test.obj", params);
 
   auto fig = scene.GetFigures()[0];
-  EXPECT_EQ(fig->GetVertices().size(), 2);
+  EXPECT_EQ(fig->GetVertexCount(), 2);
 
   float centerX = (1.0f + 4.0f) / 2;
   float centerY = (2.0f + 5.0f) / 2;
   float centerZ = (3.0f + 6.0f) / 2;
   ThreeDPoint expected(1.0f - centerX, 2.0f - centerY, 3.0f - centerZ);
-  EXPECT_EQ(fig->GetVertices()[0]->GetPosition(), expected);
+  EXPECT_EQ(fig->GetVertex(0), expected);
 }
 
 TEST(FileReaderTest, FaceParsing) {
@@ -264,7 +992,646 @@ TEST(FileReaderTest, FaceParsing) {
   Scene scene = FileReader().ReadScene("test.obj", params);
 
   auto fig = scene.GetFigures()[0];
-  EXPECT_EQ(fig->GetEdges().size(), 3);
+  EXPECT_EQ(fig->GetEdgeCount(), 3);
+}
+
+TEST(FileReaderTest, CoincidentVerticesKeepTheirEdges) {
+  std::string content =
+      "v 0 0 0\nv 1 0 0\nv 0 0 0\n"
+      "f 1 2\nf 3 2\nf 2 1";
+  std::ofstream testFile("test.obj");
+  testFile << content;
+  testFile.close();
+
+  NormalizationParameters params;
+  Scene scene = FileReader().ReadScene("test.obj", params);
+
+  auto fig = scene.GetFigures()[0];
+  ASSERT_EQ(fig->GetEdgeCount(), 2);
+  EXPECT_EQ(fig->GetEdge(0), Edge64(0, 1));
+  EXPECT_EQ(fig->GetEdge(1), Edge64(1, 2));
+}
+
+// --------------------- MappedFileReader Tests ------------------------
+
+static void ExpectSameScene(const Scene &expected, const Scene &actual) {
+  ASSERT_EQ(expected.GetFigures().size(), actual.GetFigures().size());
+  for (size_t f = 0; f < expected.GetFigures().size(); ++f) {
+    const Figure &a = *expected.GetFigures()[f];
+    const Figure &b = *actual.GetFigures()[f];
+    EXPECT_EQ(a.GetPositions(), b.GetPositions());
+    ASSERT_EQ(a.GetIndexSize(), b.GetIndexSize());
+    ASSERT_EQ(a.GetEdgeCount(), b.GetEdgeCount());
+    for (size_t i = 0; i < a.GetEdgeCount(); ++i) {
+      EXPECT_EQ(a.GetEdge(i), b.GetEdge(i));
+    }
+  }
+}
+
+TEST(FileReaderTest, GroupsAfterVerticesDropCopiedPoints) {
+  // все v до групп: вершины, скопированные группами, не остаются точками
+  // первой фигуры, а не использованная гранями вершина остаётся
+  std::ofstream("test.obj") << "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+                            << "v 5 5 5\ng a\nf 1 2 3\ng b\nf 2 4 3\n";
+  NormalizationParameters params;
+  Scene scene = FileReader().ReadScene("test.obj", params);
+  ASSERT_EQ(scene.GetFigures().size(), 3);
+  EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 0);
+  EXPECT_EQ(scene.GetFigures()[1]->GetVertexCount(), 3);
+  EXPECT_EQ(scene.GetFigures()[2]->GetVertexCount(), 3);
+  ExpectSameScene(scene, MappedFileReader().ReadScene("test.obj", params));
+  ExpectSameScene(scene,
+                  ParallelFileReader(4, 16).ReadScene("test.obj", params));
+
+  std::ofstream("test.obj") << "v 0 0 0\nv 1 0 0\nv 0 1 0\ng a\nf 1 2 3\n";
+  scene = FileReader().ReadScene("test.obj", params);
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 3);
+}
+
+TEST(MappedFileReaderTest, MatchesStreamReader) {
+  std::string content =
+      "# comment\n"
+      "mtllib cube.mtl\n"
+      "v -1.5 +2 3e1\r\n"
+      "v\t9 9 9\n"
+      "v 1 bad 0\n"
+      "vt 0.5 0.5\n"
+      "vn 0 0 1\n"
+      "v .25 -0.75 1E-2\n"
+      "v 4 5 6 1.0\n"
+      "\n"
+      "f 1/1/1 2/2/2 3//3\r\n"
+      "f 1 2 3 4 9 -1\n"
+      "f 4 4\n"
+      "f 2/1\t3 1\n"
+      "v 7 -8 9";
+  std::ofstream testFile("mapped_test.obj");
+  testFile << content;
+  testFile.close();
+
+  NormalizationParameters params;
+  Scene expected = FileReader().ReadScene("mapped_test.obj", params);
+  Scene actual = MappedFileReader().ReadScene("mapped_test.obj", params);
+
+  ASSERT_EQ(actual.GetFigures().size(), 1);
+  EXPECT_EQ(actual.GetFigures()[0]->GetVertexCount(), 4);
+  EXPECT_EQ(actual.GetMemoryUsage().vertices, 4 * 3 * sizeof(float));
+  ExpectSameScene(expected, actual);
+}
+
+TEST(MappedFileReaderTest, MissingFile) {
+  NormalizationParameters params;
+  Scene scene = MappedFileReader().ReadScene("no_such_file.obj", params);
+  EXPECT_TRUE(scene.GetFigures().empty());
+}
+
+// -------------------- ParallelFileReader Tests ------------------------
+
+TEST(ParallelFileReaderTest, MatchesSerialReader) {
+  std::ostringstream content;
+  content << "# forward reference is dropped, as in the serial reader\n"
+          << "v 0 0 0\nf 1 2 3\n";
+  for (int i = 1; i < 200; ++i) {
+    content << "v " << i << " " << (i * 7) % 13 << " " << -i * 0.5 << "\n";
+    content << "vn 0 0 1\n";
+    if (i >= 3) {
+      content << "f " << i - 1 << "//1 " << i << "//1 " << i + 1
+              << "//1 1\n";
+    }
+  }
+  content << "f 1 200 100 201";
+  std::ofstream testFile("parallel_test.obj");
+  testFile << content.str();
+  testFile.close();
+
+  NormalizationParameters params;
+  Scene expected = FileReader().ReadScene("parallel_test.obj", params);
+  Scene actual =
+      ParallelFileReader(4, 64).ReadScene("parallel_test.obj", params);
+
+  ASSERT_EQ(actual.GetFigures().size(), 1);
+  EXPECT_EQ(actual.GetFigures()[0]->GetVertexCount(), 200);
+  ExpectSameScene(expected, actual);
+}
+
+TEST(ParallelFileReaderTest, GroupsBecomeFigures) {
+  std::ostringstream content;
+  content << "g empty\no first\n";
+  for (int part = 0; part < 20; ++part) {
+    content << (part % 2 ? "g part" : "o part") << part << "\n";
+    for (int i = 0; i < 4; ++i) {
+      content << "v " << part << " " << i << " " << i * i << "\n";
+    }
+    int base = part * 4 + 1;
+    // вторая грань опирается на вершину предыдущей части
+    content << "f " << base << " " << base + 1 << " " << base + 2 << "\n"
+            << "f " << base + 3 << " " << std::max(1, base - 1) << " "
+            << base + 2 << "\n";
+  }
+  std::ofstream("parallel_test.obj") << content.str();
+
+  NormalizationParameters params;
+  Scene expected = FileReader().ReadScene("parallel_test.obj", params);
+  ASSERT_EQ(expected.GetFigures().size(), 20);
+  EXPECT_EQ(expected.GetFigures()[0]->GetVertexCount(), 4);
+  EXPECT_EQ(expected.GetFigures()[1]->GetVertexCount(), 5);
+  EXPECT_EQ(expected.GetFigures()[1]->GetEdgeCount(), 6);
+  ExpectSameScene(expected,
+                  MappedFileReader().ReadScene("parallel_test.obj", params));
+  ExpectSameScene(expected, ParallelFileReader(4, 64).ReadScene(
+                                "parallel_test.obj", params));
+}
+
+TEST(ParallelFileReaderTest, MergesClosedGroupsLikeSerialReader) {
+  // группы не ссылаются на чужие вершины; общие рёбра соседних граней и
+  // повторы одной грани разнесены по разным кускам
+  std::ostringstream content;
+  content << "v 9 9 9\ng empty\n";
+  int base = 2;
+  for (int part = 0; part < 12; ++part) {
+    content << "g part" << part << "\n";
+    for (int i = 0; i < 9; ++i) {
+      content << "v " << part << " " << i % 3 << " " << i / 3 << "\n";
+    }
+    for (int pass = 0; pass < 2; ++pass) {
+      for (int i = 0; i < 4; ++i) {
+        int a = base + i % 2 + i / 2 * 3;
+        content << "f " << a << " " << a + 1 << " " << a + 4 << " " << a + 3
+                << "\n";
+      }
+    }
+    base += 9;
+    if (part % 5 == 4) {
+      content << "g only_vertices\nv 1 2 3\n";
+      ++base;
+    }
+  }
+  std::ofstream("parallel_test.obj") << content.str();
+
+  NormalizationParameters params;
+  Scene expected = FileReader().ReadScene("parallel_test.obj", params);
+  ExpectSameScene(expected, ParallelFileReader(4, 64).ReadScene(
+                                "parallel_test.obj", params));
+}
+
+TEST(ParallelFileReaderTest, StreamsChunksInFileOrder) {
+  std::ostringstream content;
+  for (int i = 1; i <= 200; ++i) {
+    content << "v " << i << " " << i % 7 << " " << i % 3 << "\n";
+    if (i >= 3) content << "f " << i - 2 << " " << i - 1 << " " << i << "\n";
+  }
+  std::ofstream("parallel_test.obj") << content.str();
+
+  ParallelFileReader reader(4, 64);
+  size_t vertices = 0;
+  std::set<pair<uint32_t, uint32_t>> edges;
+  reader.setBatchCallback([&](shared_ptr<GeometryBatch> batch) {
+    EXPECT_EQ(batch->first_vertex, vertices);
+    vertices += batch->positions.size() / 3;
+    for (size_t i = 0; i + 1 < batch->edges.size(); i += 2) {
+      EXPECT_LT(batch->edges[i], vertices);
+      EXPECT_LT(batch->edges[i + 1], vertices);
+      edges.insert(std::minmax(batch->edges[i], batch->edges[i + 1]));
+    }
+  });
+  NormalizationParameters params;
+  Scene scene = reader.ReadScene("parallel_test.obj", params);
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(vertices, 200);
+  // повторы общих сторон граней в частях допустимы, набор рёбер - тот же
+  EXPECT_EQ(edges.size(), scene.GetFigures()[0]->GetEdgeCount());
+  ExpectSameScene(scene, MappedFileReader().ReadScene("parallel_test.obj",
+                                                      params));
+}
+
+// --------------------- StreamFileReader Tests -----------------------
+
+TEST(StreamFileReaderTest, GzipMatchesPlainReader) {
+  std::ostringstream content;
+  for (int i = 1; i <= 100; ++i) {
+    content << "v " << i << " " << i * 0.25 << " " << -i << "\n";
+    if (i >= 3) {
+      content << "f " << i - 2 << "/1 " << i - 1 << "/1 " << i << "\n";
+    }
+  }
+  std::ofstream("stream_test.obj") << content.str();
+  gzFile gz = gzopen("stream_test.obj.gz", "wb");
+  ASSERT_NE(gz, nullptr);
+  gzwrite(gz, content.str().data(), content.str().size());
+  gzclose(gz);
+
+  NormalizationParameters params;
+  Scene expected = FileReader().ReadScene("stream_test.obj", params);
+  // блоки по 7 байт: почти каждая строка разрезана между блоками
+  Scene actual =
+      StreamFileReader(7, 2).ReadScene("stream_test.obj.gz", params);
+
+  ASSERT_EQ(actual.GetFigures().size(), 1);
+  EXPECT_EQ(actual.GetFigures()[0]->GetVertexCount(), 100);
+  ExpectSameScene(expected, actual);
+}
+
+TEST(StreamFileReaderTest, ReadsStandardInput) {
+  std::ofstream("stream_test.obj") << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3";
+  int saved = dup(STDIN_FILENO);
+  int fd = open("stream_test.obj", O_RDONLY);
+  ASSERT_GE(fd, 0);
+  dup2(fd, STDIN_FILENO);
+  close(fd);
+
+  NormalizationParameters params;
+  Scene scene = StreamFileReader().ReadScene("-", params);
+  dup2(saved, STDIN_FILENO);
+  close(saved);
+
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 3);
+  EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 3);
+}
+
+TEST(StreamFileReaderTest, CancelsWhilePipeIsIdle) {
+  int pipe_fds[2];
+  ASSERT_EQ(pipe(pipe_fds), 0);
+  int saved = dup(STDIN_FILENO);
+  dup2(pipe_fds[0], STDIN_FILENO);
+  close(pipe_fds[0]);
+  // строка без конца: дальше в канал никто не пишет, но он не закрыт
+  ASSERT_EQ(write(pipe_fds[1], "v 0 0 0\nv 1", 12), 12);
+
+  StreamFileReader reader;
+  auto cancel = std::make_shared<atomic<bool>>(false);
+  reader.setCancellationToken(cancel);
+  std::thread canceller([cancel] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    cancel->store(true);
+  });
+  NormalizationParameters params;
+  Scene scene = reader.ReadScene("-", params);
+  canceller.join();
+  dup2(saved, STDIN_FILENO);
+  close(saved);
+  close(pipe_fds[1]);
+
+  EXPECT_TRUE(scene.GetFigures().empty());
+}
+
+TEST(StreamFileReaderTest, FailsOnCorruptGzip) {
+  string content = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  gzFile gz = gzopen("stream_test.obj.gz", "wb");
+  ASSERT_NE(gz, nullptr);
+  gzwrite(gz, content.data(), content.size());
+  gzclose(gz);
+  std::ifstream in("stream_test.obj.gz", std::ios::binary);
+  string packed((std::istreambuf_iterator<char>(in)),
+                std::istreambuf_iterator<char>());
+  in.close();
+
+  NormalizationParameters params;
+  // обрезанный: нет контрольной суммы и длины в конце
+  std::ofstream("stream_test.obj.gz", std::ios::binary)
+      << packed.substr(0, packed.size() - 4);
+  EXPECT_TRUE(StreamFileReader()
+                  .ReadScene("stream_test.obj.gz", params)
+                  .GetFigures()
+                  .empty());
+  // испорченная контрольная сумма
+  packed[packed.size() - 8] ^= 1;
+  std::ofstream("stream_test.obj.gz", std::ios::binary) << packed;
+  EXPECT_TRUE(StreamFileReader()
+                  .ReadScene("stream_test.obj.gz", params)
+                  .GetFigures()
+                  .empty());
+}
+
+// ------------------------ Binary Readers -------------------------
+
+static void WriteStl(const char *path,
+                     const std::vector<std::array<float, 9>> &triangles) {
+  std::ofstream out(path, std::ios::binary);
+  char header[80] = "solid binary";
+  out.write(header, sizeof(header));
+  uint32_t count = triangles.size();
+  out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  for (const auto &t : triangles) {
+    float normal[3] = {0, 0, 1};
+    uint16_t attributes = 0;
+    out.write(reinterpret_cast<const char *>(normal), sizeof(normal));
+    out.write(reinterpret_cast<const char *>(t.data()), sizeof(float) * 9);
+    out.write(reinterpret_cast<const char *>(&attributes), sizeof(attributes));
+  }
+}
+
+TEST(StlFileReaderTest, WeldsSharedPositions) {
+  // квадрат из двух треугольников, у второго ноль записан как -0
+  WriteStl("binary_test.stl", {{0, 0, 0, 1, 0, 0, 1, 1, 0},
+                               {-0.0f, 0, 0, 1, 1, 0, 0, 1, 0}});
+  ASSERT_EQ(DetectFileFormat("binary_test.stl"), FileFormat::kStl);
+
+  NormalizationParameters params;
+  Scene scene = StlFileReader().ReadScene("binary_test.stl", params);
+
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 4);
+  EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 5);
+
+  // без сварки вершины и рёбра треугольников копируются как есть
+  Scene unwelded = StlFileReader(false).ReadScene("binary_test.stl", params);
+  ASSERT_EQ(unwelded.GetFigures().size(), 1);
+  EXPECT_EQ(unwelded.GetFigures()[0]->GetVertexCount(), 6);
+  EXPECT_EQ(unwelded.GetFigures()[0]->GetEdgeCount(), 6);
+  EXPECT_EQ(unwelded.GetFigures()[0]->GetVertex(3).x,
+            scene.GetFigures()[0]->GetVertex(0).x);
+}
+
+TEST(StlFileReaderTest, ReadsAsciiAndRejectsWrongSize) {
+  std::ofstream("binary_test.stl")
+      << "solid square\n"
+      << "  facet normal 0 0 1\n    outer loop\n"
+      << "      vertex 0 0 0\n      vertex 1 0 0\n      vertex 1 1 0\n"
+      << "    endloop\n  endfacet\n"
+      << "  facet normal 0 0 1\n    outer loop\n"
+      << "      vertex -0 0 0\n      vertex 1 1 0\n      vertex 0 1 0\n"
+      << "    endloop\n  endfacet\nendsolid square\n";
+  ASSERT_EQ(DetectFileFormat("binary_test.stl"), FileFormat::kStl);
+  NormalizationParameters params;
+  Scene scene = StlFileReader().ReadScene("binary_test.stl", params);
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 4);
+  EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 5);
+
+  // лишний байт после треугольников - не двоичный STL
+  WriteStl("binary_test.stl", {{0, 0, 0, 1, 0, 0, 1, 1, 0}});
+  std::ofstream("binary_test.stl", std::ios::binary | std::ios::app) << '\0';
+  Scene rejected = StlFileReader().ReadScene("binary_test.stl", params);
+  EXPECT_TRUE(rejected.GetFigures().empty());
+}
+
+static void WritePly(const char *path, bool big_endian) {
+  auto put = [&](std::ofstream &out, auto value) {
+    char bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+    if (big_endian) std::reverse(bytes, bytes + sizeof(value));
+    out.write(bytes, sizeof(value));
+  };
+  std::ofstream out(path, std::ios::binary);
+  out << "ply\nformat "
+      << (big_endian ? "binary_big_endian" : "binary_little_endian")
+      << " 1.0\ncomment made by tests\n"
+      << "element vertex 4\nproperty float x\nproperty float y\n"
+      << "property double z\nproperty uchar red\n"
+      << "element face 2\nproperty list uchar int vertex_indices\n"
+      << "property list uchar float texcoord\nend_header\n";
+  const float xy[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+  for (int i = 0; i < 4; ++i) {
+    put(out, xy[i][0]);
+    put(out, xy[i][1]);
+    put(out, double(i));
+    put(out, uint8_t(255));
+  }
+  put(out, uint8_t(3));
+  for (int index : {0, 1, 2}) put(out, index);
+  put(out, uint8_t(0));
+  put(out, uint8_t(4));
+  for (int index : {0, 1, 2, 3}) put(out, index);
+  put(out, uint8_t(1));
+  put(out, 0.5f);
+}
+
+TEST(PlyFileReaderTest, MatchesEquivalentObj) {
+  std::ofstream("ply_test.obj")
+      << "v 0 0 0\nv 1 0 1\nv 1 1 2\nv 0 1 3\nf 1 2 3\nf 1 2 3 4\n";
+  NormalizationParameters params;
+  Scene expected = FileReader().ReadScene("ply_test.obj", params);
+
+  for (bool big_endian : {false, true}) {
+    WritePly("binary_test.ply", big_endian);
+    ASSERT_EQ(DetectFileFormat("binary_test.ply"), FileFormat::kPly);
+    Scene actual = PlyFileReader().ReadScene("binary_test.ply", params);
+    ASSERT_EQ(actual.GetFigures().size(), 1);
+    ExpectSameScene(expected, actual);
+    // общие стороны треугольника и четырёхугольника не сливаются
+    Scene unmerged =
+        PlyFileReader(false).ReadScene("binary_test.ply", params);
+    ASSERT_EQ(unmerged.GetFigures().size(), 1);
+    EXPECT_EQ(unmerged.GetFigures()[0]->GetEdgeCount(), 7);
+  }
+}
+
+TEST(PlyFileReaderTest, DropsIndicesOutOfRange) {
+  std::ofstream out("binary_test.ply", std::ios::binary);
+  out << "ply\nformat binary_little_endian 1.0\n"
+      << "element vertex 3\nproperty float x\nproperty float y\n"
+      << "property float z\nelement face 1\n"
+      << "property list uchar uint vertex_indices\nend_header\n";
+  for (float value : {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f}) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+  uint8_t count = 4;
+  out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  for (uint32_t index : {0u, 1u, 0x80000000u, 2u}) {
+    out.write(reinterpret_cast<const char *>(&index), sizeof(index));
+  }
+  out.close();
+
+  NormalizationParameters params;
+  Scene scene = PlyFileReader().ReadScene("binary_test.ply", params);
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 3);
+  EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 3);
+}
+
+TEST(PlyFileReaderTest, BoundsCountsByFileSize) {
+  // число вершин из заголовка не должно определять выделяемую память
+  std::ofstream("binary_test.ply", std::ios::binary)
+      << "ply\nformat binary_little_endian 1.0\n"
+      << "element vertex 100000000000000\nproperty float x\n"
+      << "property float y\nproperty float z\nend_header\n"
+      << std::string(3 * sizeof(float), '\0');
+  NormalizationParameters params;
+  Scene scene = PlyFileReader().ReadScene("binary_test.ply", params);
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 1);
+
+  // отрицательная и не помещающаяся в файл длины списка обрывают
+  // чтение; длина с плавающей точкой - испорченный заголовок
+  auto write_faces = [](const char *count_type, const void *count,
+                        size_t count_size) {
+    std::ofstream out("binary_test.ply", std::ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\n"
+        << "element vertex 3\nproperty float x\nproperty float y\n"
+        << "property float z\nelement face 2\nproperty list "
+        << count_type << " uint vertex_indices\nend_header\n";
+    for (float value : {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 0.f}) {
+      out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+    out.write(static_cast<const char *>(count), count_size);
+    out.write(std::string(16, '\0').data(), 16);
+  };
+  int8_t negative = -1;
+  uint32_t huge = 0xFFFFFFFFu;
+  double fractional = 3.5;
+  for (auto [type, count, size] :
+       {std::tuple<const char *, const void *, size_t>{"char", &negative, 1},
+        {"uint", &huge, 4}}) {
+    write_faces(type, count, size);
+    scene = PlyFileReader().ReadScene("binary_test.ply", params);
+    ASSERT_EQ(scene.GetFigures().size(), 1);
+    EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 3);
+    EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 0);
+  }
+  write_faces("double", &fractional, sizeof(fractional));
+  scene = PlyFileReader().ReadScene("binary_test.ply", params);
+  EXPECT_TRUE(scene.GetFigures().empty());
+}
+
+TEST(FileFormatTest, SignatureWinsOverExtension) {
+  gzFile gz = gzopen("format_test.obj", "wb");
+  ASSERT_NE(gz, nullptr);
+  gzwrite(gz, "v 0 0 0\n", 8);
+  gzclose(gz);
+  EXPECT_EQ(DetectFileFormat("format_test.obj"), FileFormat::kObjStream);
+  std::ofstream("format_test.obj") << "v 0 0 0\n";
+  EXPECT_EQ(DetectFileFormat("format_test.obj"), FileFormat::kObj);
+  EXPECT_EQ(DetectFileFormat("-"), FileFormat::kObjStream);
+}
+
+// ---------------------- Progress/Cancellation ------------------------
+
+TEST(LoadControlTest, ReportsProgressAndHonoursCancellation) {
+  std::ofstream("progress_test.obj") << "v 0 0 0\nv 1 0 0\nvn 0 0 1\nf 1 2\n";
+  vector<unique_ptr<BaseFileReader>> readers;
+  readers.push_back(std::make_unique<FileReader>());
+  readers.push_back(std::make_unique<MappedFileReader>());
+  readers.push_back(std::make_unique<ParallelFileReader>(2, 1));
+
+  NormalizationParameters params;
+  for (auto &reader : readers) {
+    LoadProgress last{0, 0, 0};
+    reader->setProgressCallback(
+        [&last](const LoadProgress &progress) { last = progress; });
+    auto cancel = std::make_shared<atomic<bool>>(false);
+    reader->setCancellationToken(cancel);
+
+    Scene scene = reader->ReadScene("progress_test.obj", params);
+    EXPECT_EQ(scene.GetFigures().size(), 1);
+    EXPECT_EQ(last.total_bytes, 31);
+    EXPECT_EQ(last.bytes_read, last.total_bytes);
+    EXPECT_EQ(last.records_parsed, 3);
+
+    cancel->store(true);
+    Scene cancelled = reader->ReadScene("progress_test.obj", params);
+    EXPECT_TRUE(cancelled.GetFigures().empty());
+  }
+}
+
+TEST(LoadControlTest, StreamingBatchesCoverTheScene) {
+  SceneBuilder builder;
+  GeometryBatch batch;
+  EXPECT_FALSE(builder.TakeBatch(batch));
+  builder.AddVertex(1, 2, 3);
+  builder.AddVertex(4, 5, 6);
+  ASSERT_TRUE(builder.TakeBatch(batch));
+  EXPECT_EQ(batch.first_vertex, 0);
+  EXPECT_EQ(batch.positions, (vector<float>{1, 2, 3, 4, 5, 6}));
+  EXPECT_TRUE(batch.edges.empty());
+  builder.AddVertex(7, 8, 9);
+  builder.AddFace({3, 1});
+  ASSERT_TRUE(builder.TakeBatch(batch));
+  EXPECT_EQ(batch.first_vertex, 2);
+  EXPECT_EQ(batch.positions.size(), 3);
+  EXPECT_EQ(batch.edges, (vector<uint32_t>{0, 2}));
+  EXPECT_FALSE(builder.TakeBatch(batch));
+
+  std::ofstream("stream_test.obj")
+      << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\ng b\nv 1 1 0\nf 2 4 3\n";
+  MappedFileReader reader;
+  size_t vertices = 0, edges = 0;
+  reader.setBatchCallback([&](shared_ptr<GeometryBatch> batch) {
+    EXPECT_EQ(batch->first_vertex, vertices);
+    vertices += batch->positions.size() / 3;
+    edges += batch->edges.size() / 2;
+  });
+  NormalizationParameters params;
+  Scene scene = reader.ReadScene("stream_test.obj", params);
+  ASSERT_EQ(scene.GetFigures().size(), 2);
+  EXPECT_EQ(vertices, scene.GetFigures()[0]->GetVertexCount() +
+                          scene.GetFigures()[1]->GetVertexCount());
+  EXPECT_EQ(edges, scene.GetFigures()[0]->GetEdgeCount() +
+                       scene.GetFigures()[1]->GetEdgeCount());
+}
+
+// --------------------- CachedFileReader Tests ------------------------
+
+class CountingReader : public BaseFileReader {
+ public:
+  explicit CountingReader(int *calls) : calls_(calls) {}
+  Scene ReadScene(string path, NormalizationParameters params) override {
+    ++*calls_;
+    return MappedFileReader().ReadScene(path, params);
+  }
+
+ private:
+  int *calls_;
+};
+
+TEST(CachedFileReaderTest, CachedSceneMatchesParsedScene) {
+  std::ofstream testFile("cache_test.obj");
+  testFile << "v 0 0 0\nv 2 0 0\nv 0 4 0\nv 1 1 -6\n"
+           << "f 1 2 3\nf 1 3 4\nf 4 2\n";
+  testFile.close();
+
+  int calls = 0;
+  CachedFileReader reader(std::make_unique<CountingReader>(&calls));
+  std::remove(reader.GetCachePath("cache_test.obj").c_str());
+
+  NormalizationParameters params;
+  Scene parsed = reader.ReadScene("cache_test.obj", params);
+  Scene cached = reader.ReadScene("cache_test.obj", params);
+
+  EXPECT_EQ(calls, 1);
+  ExpectSameScene(parsed, cached);
+}
+
+TEST(CachedFileReaderTest, ChangedSourceInvalidatesCache) {
+  std::ofstream("cache_test.obj") << "v 0 0 0\nv 1 0 0\nf 1 2\n";
+  int calls = 0;
+  CachedFileReader reader(std::make_unique<CountingReader>(&calls));
+  std::remove(reader.GetCachePath("cache_test.obj").c_str());
+
+  NormalizationParameters params;
+  reader.ReadScene("cache_test.obj", params);
+  std::ofstream("cache_test.obj") << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  Scene scene = reader.ReadScene("cache_test.obj", params);
+
+  EXPECT_EQ(calls, 2);
+  EXPECT_EQ(scene.GetFigures()[0]->GetEdgeCount(), 3);
+}
+
+TEST(CachedFileReaderTest, RejectsOverflowingCounts) {
+  std::ofstream("cache_test.obj") << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  int calls = 0;
+  CachedFileReader reader(std::make_unique<CountingReader>(&calls));
+  string cache_path = reader.GetCachePath("cache_test.obj");
+  std::remove(cache_path.c_str());
+
+  NormalizationParameters params;
+  reader.ReadScene("cache_test.obj", params);
+  // 2^62 троек float - ровно 0 байт по модулю 2^64; счётчик вершин
+  // первой фигуры идёт сразу за 48-байтовым заголовком кэша
+  uint64_t vertex_count = uint64_t(1) << 62;
+  std::fstream cache(cache_path,
+                     std::ios::in | std::ios::out | std::ios::binary);
+  cache.seekp(48);
+  cache.write(reinterpret_cast<const char *>(&vertex_count),
+              sizeof(vertex_count));
+  cache.close();
+  Scene scene = reader.ReadScene("cache_test.obj", params);
+
+  EXPECT_EQ(calls, 2);
+  ASSERT_EQ(scene.GetFigures().size(), 1);
+  EXPECT_EQ(scene.GetFigures()[0]->GetVertexCount(), 3);
 }
 
 int main(int argc, char **argv) {
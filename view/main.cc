@@ -1,5 +1,6 @@
 #include <QApplication>
 #include <QSettings>
+#include <QStandardPaths>
 
 #include "../controller/facade.h"
 #include "mainwindow.h"
@@ -7,19 +8,39 @@
 using namespace viewer;
 
 int main(int argc, char *argv[]) {
-  Scene scene;
-  Facade facade(&scene);
-  QTSceneDrawer sceneDrawer;
-
   QApplication a(argc, argv);
   QCoreApplication::setOrganizationName("PetProject");
   QCoreApplication::setApplicationName("3DViewer");
+
+  QString cacheDir =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  Facade facade(new CachedFileReader(std::make_unique<ParallelFileReader>(),
+                                     cacheDir.toStdString()),
+                new CachedFileReader(std::make_unique<StreamFileReader>(),
+                                     cacheDir.toStdString()));
+  facade.setStreamingEnabled(
+      QSettings().value("streamingLoad", true).toBool());
+  facade.setQuantizationEnabled(
+      QSettings().value("quantizePositions", false).toBool());
+  // ломаные нужны только покадровому выводу, см. MyGLWidget
+  facade.setStripsEnabled(
+      !QSettings().value("retainedRendering", true).toBool());
+  QTSceneDrawer sceneDrawer;
   MainWindow w;
   w.setFacade(&facade);
   QObject::connect(&w, &MainWindow::loadSceneRequested, &facade,
                    &Facade::onLoadSceneRequested);
   QObject::connect(&facade, &Facade::sceneLoaded, &w,
                    &MainWindow::onSceneLoaded);
+  QObject::connect(&facade, &Facade::loadProgress, &w,
+                   &MainWindow::onLoadProgress);
+  QObject::connect(&facade, &Facade::loadCancelled, &w,
+                   &MainWindow::onLoadCancelled);
   w.show();
+  // 3DViewer model.obj.gz или `... | 3DViewer -` для чтения из канала
+  if (a.arguments().size() > 1) {
+    facade.LoadSceneAsync(a.arguments().at(1).toStdString(),
+                          NormalizationParameters());
+  }
   return a.exec();
 }
\ No newline at end of file
@@ -152,20 +152,67 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow() { delete ui; }
 
-void MainWindow::setFacade(Facade *facade) { this->facade_ = facade; }
+void MainWindow::setFacade(Facade *facade) {
+  this->facade_ = facade;
+  connect(facade_, &Facade::geometryBatchLoaded, ui->sceneWidget,
+          &MyGLWidget::appendBatch);
+  connect(ui->sceneWidget, &MyGLWidget::aboutToPaint, facade_,
+          &Facade::ApplyPendingTransforms);
+}
 
 void MainWindow::onSceneLoaded(const SceneInfo &info) {
   QString fileName_ = QString::fromStdString(info.file_name);
 
-  ui->label->setText(QString("File name: %1\nVertices: %2\nEdges: %3")
-                         .arg(fileName_)
-                         .arg(info.vertex_count)
-                         .arg(info.edge_count));
+  auto megabytes = [](size_t bytes) {
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+  };
+  ui->label->setText(
+      QString("File name: %1\nVertices: %2\nEdges: %3\n"
+              "Memory: %4 MB (vertices %5, edges %6)")
+          .arg(fileName_)
+          .arg(info.vertex_count)
+          .arg(info.edge_count)
+          .arg(megabytes(info.memory.Total()))
+          .arg(megabytes(info.memory.vertices))
+          .arg(megabytes(info.memory.edges)));
+  if (info.quantization_error > 0) {
+    ui->label->setText(ui->label->text() +
+                       QString("\n16-bit positions, max error %1")
+                           .arg(info.quantization_error, 0, 'g', 3));
+  }
+  ui->statusbar->clearMessage();
+  if (ui->sceneWidget->isStreaming() && facade_) {
+    ui->sceneWidget->setScene(facade_->getScene());
+  }
+}
+
+void MainWindow::onLoadProgress(qint64 bytesRead, qint64 totalBytes,
+                                qint64 recordsParsed) {
+  int percent = totalBytes > 0 ? static_cast<int>(100 * bytesRead / totalBytes)
+                               : 0;
+  ui->statusbar->showMessage(
+      QString("Loading: %1% (%2 records), Esc to cancel")
+          .arg(percent)
+          .arg(recordsParsed));
+}
+
+void MainWindow::onLoadCancelled() {
+  ui->statusbar->showMessage("Loading cancelled", 3000);
+  ui->sceneWidget->clearStreaming();
+}
+
+void MainWindow::keyPressEvent(QKeyEvent *event) {
+  if (event->key() == Qt::Key_Escape && facade_ && facade_->IsLoading()) {
+    facade_->CancelLoading();
+    return;
+  }
+  QMainWindow::keyPressEvent(event);
 }
 
 void MainWindow::on_chooseFileButton_clicked() {
   fileName_ = QFileDialog::getOpenFileName(
-      this, "Выберите файл", QDir::homePath(), "obj файлы (*.obj)");
+      this, "Выберите файл", QDir::homePath(),
+      "Модели (*.obj *.obj.gz *.stl *.ply)");
   NormalizationParameters params;
   if (!fileName_.isEmpty()) {
     emit loadSceneRequested(fileName_, params);
@@ -175,10 +222,7 @@ void MainWindow::on_chooseFileButton_clicked() {
 void MainWindow::on_openFileButton_clicked() {
   if (!fileName_.isEmpty()) {
     if (facade_) {
-      Scene *scene_ptr = facade_->getScene();
-      if (scene_ptr) {
-        ui->sceneWidget->setScene(*scene_ptr);
-      }
+      ui->sceneWidget->setScene(facade_->getScene());
     }
     ui->sceneWidget->update();
   }
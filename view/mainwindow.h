@@ -7,6 +7,7 @@
 #include <QFile>
 #include <QFileDialog>
 #include <QFontDatabase>
+#include <QKeyEvent>
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QOpenGLFunctions>
@@ -39,6 +40,9 @@ class MainWindow : public QMainWindow {
   void loadSceneRequested(const QString &path, NormalizationParameters params);
  public slots:
   void onSceneLoaded(const SceneInfo &info);
+  void onLoadProgress(qint64 bytesRead, qint64 totalBytes,
+                      qint64 recordsParsed);
+  void onLoadCancelled();
  private slots:
   void on_openFileButton_clicked();
   void on_chooseFileButton_clicked();
@@ -86,6 +90,7 @@ class MainWindow : public QMainWindow {
 
  protected:
   void closeEvent(QCloseEvent *event) override;
+  void keyPressEvent(QKeyEvent *event) override;
 };
 }  // namespace viewer
 
@@ -11,22 +11,149 @@ MyGLWidget::MyGLWidget(QWidget* parent)
       yMove_(0),
       currentScale_(1.0f),
       facade_(nullptr) {
-  sceneDrawer_ = new QTSceneDrawer();
+  // буферы GL по умолчанию; настройка нужна для сравнения со старым
+  // покадровым выводом вершин
+  if (QSettings().value("retainedRendering", true).toBool()) {
+    sceneDrawer_ = new VboSceneDrawer();
+  } else {
+    sceneDrawer_ = new QTSceneDrawer();
+  }
   setMouseTracking(true);
   setFocusPolicy(Qt::StrongFocus);
 }
 
 MyGLWidget::~MyGLWidget() {
+  clearStreaming();
   makeCurrent();
   delete sceneDrawer_;
   doneCurrent();
 }
 
-void MyGLWidget::setScene(const viewer::Scene& scene) {
-  currentScene_ = scene;
+void MyGLWidget::setScene(std::shared_ptr<const Scene> scene) {
+  clearStreaming();
+  currentScene_ = std::move(scene);
   update();
 }
 
+void MyGLWidget::appendBatch(std::shared_ptr<const GeometryBatch> batch) {
+  if (batch->first_vertex == 0) {
+    clearStreaming();
+  }
+  if (!isStreaming_) {
+    isStreaming_ = true;
+    streamMin_.fill(std::numeric_limits<float>::max());
+    streamMax_.fill(std::numeric_limits<float>::lowest());
+  }
+  const std::vector<float>& positions = batch->positions;
+  for (size_t i = 0; i + 2 < positions.size(); i += 3) {
+    for (int axis = 0; axis < 3; ++axis) {
+      streamMin_[axis] = std::min(streamMin_[axis], positions[i + axis]);
+      streamMax_[axis] = std::max(streamMax_[axis], positions[i + axis]);
+    }
+  }
+  pendingBatches_.push_back(std::move(batch));
+  update();
+}
+
+void MyGLWidget::clearStreaming() {
+  if (isValid()) {
+    makeCurrent();
+    for (StreamBuffer* buffer : {&streamPositions_, &streamEdges_}) {
+      if (buffer->id) {
+        glDeleteBuffers(1, &buffer->id);
+      }
+    }
+    doneCurrent();
+  }
+  streamPositions_ = StreamBuffer();
+  streamEdges_ = StreamBuffer();
+  pendingBatches_.clear();
+  isStreaming_ = false;
+}
+
+void MyGLWidget::appendToBuffer(StreamBuffer& buffer, size_t offset,
+                                const void* data, size_t size) {
+  if (size == 0) return;
+  QOpenGLExtraFunctions* extra = context()->extraFunctions();
+  if (offset + size > buffer.capacity) {
+    size_t capacity = std::max(offset + size, buffer.capacity * 3 / 2);
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+    if (buffer.id) {
+      glBindBuffer(GL_COPY_READ_BUFFER, buffer.id);
+      extra->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                 0, 0, buffer.size);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      glDeleteBuffers(1, &buffer.id);
+    }
+    buffer.id = grown;
+    buffer.capacity = capacity;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  buffer.size = std::max(buffer.size, offset + size);
+}
+
+void MyGLWidget::uploadPendingBatches() {
+  // без копирования между буферами (GL ниже 3.1) рост буфера потребовал
+  // бы копии в памяти процесса: предпросмотр не строится, модель
+  // появится по завершении загрузки
+  bool can_copy = context()->format().version() >= qMakePair(3, 1) ||
+                  context()->hasExtension("GL_ARB_copy_buffer");
+  for (const auto& batch : pendingBatches_) {
+    if (!can_copy) break;
+    const std::vector<float>& positions = batch->positions;
+    appendToBuffer(streamPositions_, batch->first_vertex * 3 * sizeof(float),
+                   positions.data(), positions.size() * sizeof(float));
+    const std::vector<uint32_t>& edges = batch->edges;
+    appendToBuffer(streamEdges_, streamEdges_.size, edges.data(),
+                   edges.size() * sizeof(uint32_t));
+  }
+  pendingBatches_.clear();
+}
+
+void MyGLWidget::drawStreamingPreview() {
+  uploadPendingBatches();
+  if (streamPositions_.size == 0) return;
+
+  // центр уточняется по мере загрузки, загруженные части не обновляются
+  glPushMatrix();
+  glTranslatef(-(streamMin_[0] + streamMax_[0]) / 2,
+               -(streamMin_[1] + streamMax_[1]) / 2,
+               -(streamMin_[2] + streamMax_[2]) / 2);
+
+  glBindBuffer(GL_ARRAY_BUFFER, streamPositions_.id);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, nullptr);
+
+  if (streamEdges_.size) {
+    glColor3f(edge_color_.redF(), edge_color_.greenF(), edge_color_.blueF());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, streamEdges_.id);
+    glDrawElements(GL_LINES, streamEdges_.size / sizeof(uint32_t),
+                   GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+
+  if (vertex_style_ != INVISIBLE) {
+    glPointSize(vertex_size_);
+    if (vertex_style_ == CIRCLE) {
+      glEnable(GL_POINT_SMOOTH);
+    } else {
+      glDisable(GL_POINT_SMOOTH);
+    }
+    glColor3f(vertex_color_.redF(), vertex_color_.greenF(),
+              vertex_color_.blueF());
+    glDrawArrays(GL_POINTS, 0, streamPositions_.size / (3 * sizeof(float)));
+  }
+
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glPopMatrix();
+}
+
 void MyGLWidget::initializeGL() {
   initializeOpenGLFunctions();
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -60,6 +187,7 @@ void MyGLWidget::updateProjection() {
 }
 
 void MyGLWidget::paintGL() {
+  emit aboutToPaint();
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
@@ -99,8 +227,14 @@ void MyGLWidget::paintGL() {
 
   glLineWidth(edge_size_);
 
+  if (isStreaming_) {
+    drawStreamingPreview();
+    return;
+  }
+  if (!currentScene_) return;
+
   if (sceneDrawer_) {
-    sceneDrawer_->DrawScene(currentScene_, edge_color_);
+    sceneDrawer_->DrawScene(*currentScene_, edge_color_);
   }
   if (vertex_style_ != INVISIBLE) {
     glPointSize(vertex_size_);
@@ -110,17 +244,9 @@ void MyGLWidget::paintGL() {
     } else {
       glDisable(GL_POINT_SMOOTH);
     }
-
-    glBegin(GL_POINTS);
-    glColor3f(vertex_color_.redF(), vertex_color_.greenF(),
-              vertex_color_.blueF());
-    for (auto& figure : currentScene_.GetFigures()) {
-      for (auto& vertex : figure->GetVertices()) {
-        ThreeDPoint p = vertex->GetPosition();
-        glVertex3f(p.x, p.y, p.z);
-      }
+    if (sceneDrawer_) {
+      sceneDrawer_->DrawPoints(*currentScene_, vertex_color_);
     }
-    glEnd();
   }
 }
 
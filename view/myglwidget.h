@@ -10,19 +10,23 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QMouseEvent>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLFunctions>
 #include <QOpenGLWidget>
 #include <QPixmap>
 #include <QPoint>
 #include <QScreen>
+#include <QSettings>
 #include <QVector3D>
 #include <QVector>
 #include <QWheelEvent>
 
 #include "qtscenedrawer.h"
+#include "vboscenedrawer.h"
 using namespace viewer;
 namespace viewer {
-class QTSceneDrawer;
+class SceneDrawerBase;
 class Facade;
 }  // namespace viewer
 class MyGLWidget : public QOpenGLWidget, protected QOpenGLFunctions {
@@ -38,7 +42,15 @@ class MyGLWidget : public QOpenGLWidget, protected QOpenGLFunctions {
 
   enum ProjectionStyle { PERSPECTIVE, ORTHOGRAPHIC };
 
-  void setScene(const Scene& scene);
+  // Вид разделяет владение сценой с фасадом: после загрузки новой сцены
+  // показанная остаётся жива, пока не будет заменена здесь.
+  void setScene(std::shared_ptr<const Scene> scene);
+  // Предпросмотр загружаемой модели: части рисуются по мере поступления.
+  // В ближайшем кадре часть дописывается в буферы GL и освобождается,
+  // копии модели в памяти процесса не остаётся.
+  void appendBatch(std::shared_ptr<const GeometryBatch> batch);
+  void clearStreaming();
+  bool isStreaming() const { return isStreaming_; }
   QByteArray getWidgetScreenshot(const char* format, int quality = -1);
 
   void setBackgroundColor(const QColor& color);
@@ -64,6 +76,11 @@ class MyGLWidget : public QOpenGLWidget, protected QOpenGLFunctions {
 
   void updateProjection();
 
+ signals:
+  // Испускается в начале paintGL, до чтения позиций сцены: отложенные
+  // преобразования применяются не чаще одного раза за кадр.
+  void aboutToPaint();
+
  protected:
   void initializeGL() override;
   void resizeGL(int w, int h) override;
@@ -74,8 +91,19 @@ class MyGLWidget : public QOpenGLWidget, protected QOpenGLFunctions {
   void wheelEvent(QWheelEvent* event) override;
 
  private:
-  QTSceneDrawer* sceneDrawer_;
-  Scene currentScene_;
+  // Буфер GL, растущий по мере загрузки; size - занятые байты.
+  struct StreamBuffer {
+    GLuint id = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+  };
+  void appendToBuffer(StreamBuffer& buffer, size_t offset, const void* data,
+                      size_t size);
+  void uploadPendingBatches();
+  void drawStreamingPreview();
+
+  SceneDrawerBase* sceneDrawer_;
+  std::shared_ptr<const Scene> currentScene_;
   QColor background_color_ = Qt::black;
   QColor edge_color_ = Qt::white;
   QColor vertex_color_ = Qt::red;
@@ -93,6 +121,13 @@ class MyGLWidget : public QOpenGLWidget, protected QOpenGLFunctions {
   float xMove_, yMove_;
   QPoint lastRightMousePos_;
   Facade* facade_;
+
+  bool isStreaming_ = false;
+  std::vector<std::shared_ptr<const GeometryBatch>> pendingBatches_;
+  StreamBuffer streamPositions_;
+  StreamBuffer streamEdges_;
+  std::array<float, 3> streamMin_;
+  std::array<float, 3> streamMax_;
 };
 
 #endif  // SRC_3DVIEWER_VIEW_MYGLWIDGET_H_
\ No newline at end of file
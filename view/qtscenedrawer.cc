@@ -2,24 +2,83 @@
 
 using namespace viewer;
 
-void QTSceneDrawer::DrawScene(Scene scene, const QColor& edgeColor) {
+void QTSceneDrawer::DrawScene(const Scene& scene, const QColor& edgeColor) {
   initializeOpenGLFunctions();
-  glBegin(GL_LINES);
   glColor3f(edgeColor.redF(), edgeColor.greenF(), edgeColor.blueF());
+  ForgetRemovedFigures();
+  View view = CurrentView();
+  Frustum frustum = view.GetFrustum();
 
   for (auto& figure : scene.GetFigures()) {
-    for (auto& edge : figure->GetEdges()) {
-      auto v1 = edge.GetBegin();
-      auto v2 = edge.GetEnd();
-      if (v1 && v2) {
-        ThreeDPoint p1 = v1->GetPosition();
-        ThreeDPoint p2 = v2->GetPosition();
-        glVertex3f(p1.x, p1.y, p1.z);
-        glVertex3f(p2.x, p2.y, p2.z);
-      }
+    // поза фигуры умножается на текущую матрицу вида, вершины остаются
+    // такими, как их загрузили; уровень детализации рисуется с той же
+    // матрицей
+    DrawEdges(*LodFor(figure, view), figure->GetModelMatrix(), frustum);
+  }
+}
+
+void QTSceneDrawer::DrawEdges(const Figure& drawn, const AffineMatrix& model,
+                              const Frustum& frustum) {
+  glPushMatrix();
+  glMultMatrixf(model.GetColumnMajor().data());
+  drawn.VisitPositions([&](const auto& stored) {
+    const auto* positions = stored.data();
+    if (drawn.HasStrips()) {
+      // ломаные идут в порядке обхода, а не кластеров, и рисуются целиком;
+      // общая вершина соседних рёбер ломаной передаётся один раз
+      drawn.VisitStrips([positions](const auto& strips) {
+        using Index = typename std::decay_t<decltype(strips)>::value_type;
+        glBegin(GL_LINE_STRIP);
+        for (Index index : strips) {
+          if (index == std::numeric_limits<Index>::max()) {
+            glEnd();
+            glBegin(GL_LINE_STRIP);
+          } else {
+            DrawVertex(positions + index * 3);
+          }
+        }
+        glEnd();
+      });
+      return;
     }
+    glBegin(GL_LINES);
+    drawn.VisitEdges([&](const auto& edges) {
+      for (IndexRange range : VisibleRanges(model, drawn.GetEdgeClusters(),
+                                            edges.size(), frustum)) {
+        for (size_t i = range.begin; i < range.end; ++i) {
+          DrawVertex(positions + edges[i].GetBegin() * 3);
+          DrawVertex(positions + edges[i].GetEnd() * 3);
+        }
+      }
+    });
+    glEnd();
+  });
+  glPopMatrix();
+}
+
+void QTSceneDrawer::DrawPoints(const Scene& scene, const QColor& vertexColor) {
+  initializeOpenGLFunctions();
+  glColor3f(vertexColor.redF(), vertexColor.greenF(), vertexColor.blueF());
+  View view = CurrentView();
+  Frustum frustum = view.GetFrustum();
+
+  for (auto& figure : scene.GetFigures()) {
+    const Figure& drawn = *LodFor(figure, view);
+    const AffineMatrix& model = figure->GetModelMatrix();
+    glPushMatrix();
+    glMultMatrixf(model.GetColumnMajor().data());
+    glBegin(GL_POINTS);
+    drawn.VisitPositions([&](const auto& positions) {
+      for (IndexRange range : VisibleRanges(model, drawn.GetVertexClusters(),
+                                            positions.size() / 3, frustum)) {
+        for (size_t i = range.begin; i < range.end; ++i) {
+          DrawVertex(&positions[i * 3]);
+        }
+      }
+    });
+    glEnd();
+    glPopMatrix();
   }
-  glEnd();
 }
 
 QByteArray QTSceneDrawer::getScreenshot(QWidget* widget, const char* format,
@@ -13,11 +13,21 @@
 
 #include "scenedrawerbase.h"
 namespace viewer {
+// Вершина из массива позиций фигуры любого типа хранения.
+inline void DrawVertex(const float* position) { glVertex3fv(position); }
+inline void DrawVertex(const int16_t* position) { glVertex3sv(position); }
+
 class QTSceneDrawer : public SceneDrawerBase, protected QOpenGLFunctions {
   Q_OBJECT
  public:
   explicit QTSceneDrawer() {};
-  void DrawScene(Scene scene, const QColor& edgeColor = Qt::white) override;
+  void DrawScene(const Scene& scene,
+                 const QColor& edgeColor = Qt::white) override;
+  void DrawPoints(const Scene& scene, const QColor& vertexColor) override;
+  // Рёбра одной фигуры (или её уровня детализации drawn) с матрицей
+  // модели model; цвет задаёт вызывающий.
+  void DrawEdges(const Figure& drawn, const AffineMatrix& model,
+                 const Frustum& frustum);
 
   QByteArray getScreenshot(QWidget* widget, const char* format,
                            int quality = -1);
@@ -2,6 +2,8 @@
 #define SRC_3DVIEWER_VIEW_SCENEDRAWERBASE_H_
 
 #include <QObject>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
 
 #include "../controller/facade.h"
 
@@ -9,8 +11,74 @@ namespace viewer {
 class SceneDrawerBase : public QObject {
   Q_OBJECT
  public:
-  virtual void DrawScene(Scene scene, const QColor& edgeColor) = 0;
+  // Сцена передаётся по ссылке: кадр не копирует ни геометрию, ни
+  // указатели на фигуры.
+  virtual void DrawScene(const Scene& scene, const QColor& edgeColor) = 0;
+  // Вершины фигур точками; размер и сглаживание точек задаёт вызывающий.
+  virtual void DrawPoints(const Scene& scene, const QColor& vertexColor) = 0;
   virtual ~SceneDrawerBase() = default;
+
+ protected:
+  // Матрицы вида и проекции фиксированного конвейера и область вывода.
+  struct View {
+    std::array<float, 16> projection;
+    std::array<float, 16> modelView;
+    std::array<GLint, 4> viewport;
+    Frustum GetFrustum() const { return Frustum(projection, modelView); }
+  };
+  // Контекст GL должен быть текущим.
+  static View CurrentView() {
+    QOpenGLFunctions* gl = QOpenGLContext::currentContext()->functions();
+    View view;
+    gl->glGetFloatv(GL_PROJECTION_MATRIX, view.projection.data());
+    gl->glGetFloatv(GL_MODELVIEW_MATRIX, view.modelView.data());
+    gl->glGetIntegerv(GL_VIEWPORT, view.viewport.data());
+    return view;
+  }
+  // Диапазоны элементов [0, count), чьи кластеры пересекают frustum при
+  // матрице модели model; без кластеров - весь диапазон. Результат
+  // живёт до следующего вызова.
+  const std::vector<IndexRange>& VisibleRanges(
+      const AffineMatrix& model, std::span<const Cluster> clusters,
+      size_t count, const Frustum& frustum) {
+    if (clusters.empty()) {
+      visible_.assign(1, IndexRange{0, count});
+    } else {
+      CullClusters(clusters, frustum.Transformed(model), visible_,
+                   WorkerPool::Shared());
+    }
+    return visible_;
+  }
+  // Что рисовать вместо figure: её саму или уровень детализации по
+  // Figure::SelectLod. Уровень прошлого кадра хранится для каждой
+  // фигуры, поэтому DrawScene и DrawPoints одного кадра получают один и
+  // тот же уровень.
+  const std::shared_ptr<Figure>& LodFor(const std::shared_ptr<Figure>& figure,
+                                        const View& view) {
+    LodState& state = lods_[figure.get()];
+    // истёкший указатель - прежняя фигура удалена, а адрес занят новой
+    if (state.figure.expired()) state = {figure, 0};
+    state.level = figure->SelectLod(view.projection, view.modelView,
+                                    view.viewport[2], view.viewport[3],
+                                    state.level);
+    if (state.level == 0) return figure;
+    return figure->GetLods()[state.level - 1].figure;
+  }
+  // Забывает уровни фигур, которых больше нет.
+  void ForgetRemovedFigures() {
+    std::erase_if(lods_, [](const auto& entry) {
+      return entry.second.figure.expired();
+    });
+  }
+
+ private:
+  struct LodState {
+    std::weak_ptr<const Figure> figure;
+    size_t level = 0;
+  };
+
+  std::vector<IndexRange> visible_;
+  std::unordered_map<const Figure*, LodState> lods_;
 };
 }  // namespace viewer
 
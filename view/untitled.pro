@@ -1,5 +1,5 @@
 QT += core gui opengl widgets
-LIBS += -lGLU -lgif
+LIBS += -lGLU -lgif -lz
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++20
@@ -8,13 +8,31 @@ SOURCES += \
     main.cc \
     mainwindow.cc \
     ../controller/facade.cc \
+    ../model/basefilereader.cc \
+    ../model/cachedfilereader.cc \
+    ../model/clusters.cc \
     ../model/edge.cc \
+    ../model/edgeindexset.cc \
+    ../model/edgestrips.cc \
     ../model/figure.cc \
+    ../model/fileformat.cc \
+    ../model/lods.cc \
     ../model/objparser.cc \
+    ../model/objrecordparser.cc \
+    ../model/mappedfile.cc \
+    ../model/mappedobjparser.cc \
+    ../model/parallelobjparser.cc \
+    ../model/plyparser.cc \
+    ../model/scenebuilder.cc \
+    ../model/stlparser.cc \
+    ../model/streamobjparser.cc \
     ../model/transformmatrix.cc \
     ../model/transformmatrixbuilder.cc \
+    ../model/transformpoints.cc \
     ../model/vertex.cc \
+    ../model/workerpool.cc \
     qtscenedrawer.cc \
+    vboscenedrawer.cc \
     myglwidget.cc \
     gifrecorder.cc \
     ../model/point.cc
@@ -27,6 +45,7 @@ HEADERS += \
     ../model/model.h \
     ../controller/facade.h \
     qtscenedrawer.h \
+    vboscenedrawer.h \
     scenedrawerbase.h \
     myglwidget.h \
     gifrecorder.h
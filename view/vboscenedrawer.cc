@@ -0,0 +1,257 @@
+#include "vboscenedrawer.h"
+
+#include <QDebug>
+
+using namespace viewer;
+
+namespace {
+constexpr GLuint kPositionLocation = 0;
+
+// Вид и проекция - из матриц фиксированного конвейера, поза - uniform.
+constexpr char kVertexShader[] = R"(#version 120
+attribute vec3 position;
+uniform mat4 model;
+void main() {
+  gl_Position = gl_ModelViewProjectionMatrix * (model * vec4(position, 1.0));
+}
+)";
+
+constexpr char kFragmentShader[] = R"(#version 120
+uniform vec4 color;
+void main() { gl_FragColor = color; }
+)";
+}  // namespace
+
+VboSceneDrawer::~VboSceneDrawer() {
+  for (auto& [figure, buffers] : buffers_) {
+    Release(*buffers);
+  }
+}
+
+bool VboSceneDrawer::Initialize() {
+  initialized_ = true;
+  initializeOpenGLFunctions();
+  usable_ =
+      program_.addShaderFromSourceCode(QOpenGLShader::Vertex, kVertexShader) &&
+      program_.addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                       kFragmentShader);
+  if (usable_) {
+    program_.bindAttributeLocation("position", kPositionLocation);
+    usable_ = program_.link();
+  }
+  if (!usable_) {
+    qWarning() << "VboSceneDrawer: falling back to immediate mode:"
+               << program_.log();
+    return false;
+  }
+  modelLocation_ = program_.uniformLocation("model");
+  colorLocation_ = program_.uniformLocation("color");
+  return true;
+}
+
+void VboSceneDrawer::DrawScene(const Scene& scene, const QColor& edgeColor) {
+  if (!initialized_) Initialize();
+  if (!usable_) {
+    fallback_.DrawScene(scene, edgeColor);
+    return;
+  }
+  ++frame_;
+  ForgetRemovedFigures();
+  View view = CurrentView();
+  Frustum frustum = view.GetFrustum();
+  // фигуры с 64-битными номерами рёбер, которые GL не принимает
+  std::vector<std::pair<const Figure*, AffineMatrix>> wide;
+  DrawFigures(scene, view, edgeColor, [&](const Figure& figure,
+                                          const AffineMatrix& model,
+                                          const FigureBuffers& buffers) {
+    if (figure.GetIndexSize() > sizeof(GLuint)) {
+      wide.emplace_back(&figure, model);
+      return;
+    }
+    if (buffers.indexCount == 0) return;
+    // ребро - два номера; видимые кластеры соседствуют в буфере, так что
+    // вызовов столько, сколько непрерывных видимых участков
+    size_t edgeSize = 2 * (buffers.indexType == GL_UNSIGNED_SHORT
+                               ? sizeof(GLushort)
+                               : sizeof(GLuint));
+    for (IndexRange range : VisibleRanges(model, figure.GetEdgeClusters(),
+                                          buffers.indexCount / 2, frustum)) {
+      glDrawElements(GL_LINES, GLsizei((range.end - range.begin) * 2),
+                     buffers.indexType,
+                     reinterpret_cast<const void*>(range.begin * edgeSize));
+    }
+  });
+  // их рёбра рисует покадровый вывод, точки - по-прежнему буферы
+  if (!wide.empty()) {
+    glColor3f(edgeColor.redF(), edgeColor.greenF(), edgeColor.blueF());
+    for (const auto& [figure, model] : wide) {
+      fallback_.DrawEdges(*figure, model, frustum);
+    }
+  }
+  // буферы фигур, которых больше нет на экране
+  std::erase_if(buffers_, [this](auto& entry) {
+    if (entry.second->frame == frame_) return false;
+    Release(*entry.second);
+    return true;
+  });
+}
+
+void VboSceneDrawer::DrawPoints(const Scene& scene,
+                                const QColor& vertexColor) {
+  if (!initialized_) Initialize();
+  if (!usable_) {
+    fallback_.DrawPoints(scene, vertexColor);
+    return;
+  }
+  View view = CurrentView();
+  Frustum frustum = view.GetFrustum();
+  DrawFigures(scene, view, vertexColor, [&](const Figure& figure,
+                                            const AffineMatrix& model,
+                                            const FigureBuffers& buffers) {
+    for (IndexRange range : VisibleRanges(model, figure.GetVertexClusters(),
+                                          buffers.vertexCount, frustum)) {
+      glDrawArrays(GL_POINTS, GLint(range.begin),
+                   GLsizei(range.end - range.begin));
+    }
+  });
+}
+
+template <typename F>
+void VboSceneDrawer::DrawFigures(const Scene& scene, const View& view,
+                                 const QColor& color, F draw) {
+  program_.bind();
+  glUniform4f(colorLocation_, color.redF(), color.greenF(), color.blueF(),
+              color.alphaF());
+  for (auto& figure : scene.GetFigures()) {
+    const std::shared_ptr<Figure>& drawn = LodFor(figure, view);
+    FigureBuffers& buffers = BuffersFor(drawn);
+    KeepLevels(*figure);
+    const AffineMatrix& model = figure->GetModelMatrix();
+    glUniformMatrix4fv(modelLocation_, 1, GL_FALSE,
+                       model.GetColumnMajor().data());
+    if (buffers.vao.isCreated()) {
+      buffers.vao.bind();
+      draw(*drawn, model, buffers);
+      buffers.vao.release();
+    } else {
+      BindAttributes(buffers);
+      draw(*drawn, model, buffers);
+      glDisableVertexAttribArray(kPositionLocation);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+  }
+  program_.release();
+}
+
+void VboSceneDrawer::KeepLevels(const Figure& figure) {
+  auto keep = [this](const Figure* level) {
+    auto found = buffers_.find(level);
+    if (found != buffers_.end()) found->second->frame = frame_;
+  };
+  keep(&figure);
+  for (const LodLevel& lod : figure.GetLods()) keep(lod.figure.get());
+}
+
+VboSceneDrawer::FigureBuffers& VboSceneDrawer::BuffersFor(
+    const std::shared_ptr<Figure>& figure) {
+  auto& buffers = buffers_[figure.get()];
+  if (!buffers) {
+    buffers = std::make_unique<FigureBuffers>();
+    glGenBuffers(1, &buffers->positions);
+    glGenBuffers(1, &buffers->edges);
+    // без VAO атрибуты задаются перед каждым вызовом отрисовки
+    buffers->vao.create();
+  }
+  // истёкший указатель - прежняя фигура удалена, а адрес занят новой
+  bool fresh = buffers->figure.expired();
+  if (fresh || buffers->version != figure->GetGeometryVersion()) {
+    if (fresh || buffers->version != figure->GetDirtyBaseVersion()) {
+      Upload(*figure, *buffers, {0, figure->GetVertexCount()},
+             {0, figure->GetEdgeCount()});
+    } else {
+      Upload(*figure, *buffers, figure->GetDirtyVertices(),
+             figure->GetDirtyEdges());
+    }
+    buffers->figure = figure;
+    buffers->version = figure->GetGeometryVersion();
+    figure->ClearDirtyRanges();
+  }
+  buffers->frame = frame_;
+  return *buffers;
+}
+
+void VboSceneDrawer::Upload(const Figure& figure, FigureBuffers& buffers,
+                            IndexRange vertices, IndexRange edges) {
+  figure.VisitPositions([&](auto positions) {
+    using Coordinate = typename decltype(positions)::value_type;
+    buffers.positionType =
+        std::is_same_v<Coordinate, int16_t> ? GL_SHORT : GL_FLOAT;
+    buffers.vertexCount = GLsizei(positions.size() / 3);
+    constexpr size_t kVertexSize = 3 * sizeof(Coordinate);
+    WriteBuffer(GL_ARRAY_BUFFER, buffers.positions, buffers.positionCapacity,
+                std::as_bytes(positions), vertices.begin * kVertexSize,
+                vertices.end * kVertexSize);
+  });
+  figure.VisitEdges([&](auto stored) {
+    using Index = typename decltype(stored)::value_type::IndexType;
+    static_assert(sizeof(stored[0]) == 2 * sizeof(Index),
+                  "ребро должно лежать в памяти парой номеров");
+    // GL не принимает номера шире 32 бит: рёбра такой фигуры рисует
+    // QTSceneDrawer::DrawEdges, см. DrawScene
+    if constexpr (sizeof(Index) > sizeof(GLuint)) {
+      buffers.indexCount = 0;
+    } else {
+      buffers.indexType =
+          sizeof(Index) == sizeof(GLushort) ? GL_UNSIGNED_SHORT
+                                            : GL_UNSIGNED_INT;
+      buffers.indexCount = GLsizei(stored.size() * 2);
+      WriteBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.edges, buffers.edgeCapacity,
+                  std::as_bytes(stored), edges.begin * sizeof(stored[0]),
+                  edges.end * sizeof(stored[0]));
+    }
+  });
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  if (buffers.vao.isCreated()) {
+    // VAO запоминает формат позиций и индексный буфер
+    buffers.vao.bind();
+    BindAttributes(buffers);
+    buffers.vao.release();
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VboSceneDrawer::WriteBuffer(GLenum target, GLuint buffer,
+                                 size_t& capacity,
+                                 std::span<const std::byte> data,
+                                 size_t begin, size_t end) {
+  glBindBuffer(target, buffer);
+  if (data.size() > capacity) {
+    // загруженная целиком фигура получает буфер точно по размеру, а
+    // растущая - с запасом, чтобы добавление по одной вершине не
+    // пересоздавало буфер каждый раз
+    capacity = capacity == 0 ? data.size()
+                             : std::max(data.size(), capacity + capacity / 2);
+    glBufferData(target, capacity, nullptr, GL_STATIC_DRAW);
+    begin = 0;
+    end = data.size();
+  }
+  end = std::min(end, data.size());
+  if (begin < end) {
+    glBufferSubData(target, begin, end - begin, data.data() + begin);
+  }
+}
+
+void VboSceneDrawer::BindAttributes(FigureBuffers& buffers) {
+  glBindBuffer(GL_ARRAY_BUFFER, buffers.positions);
+  glVertexAttribPointer(kPositionLocation, 3, buffers.positionType, GL_FALSE,
+                        0, nullptr);
+  glEnableVertexAttribArray(kPositionLocation);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.edges);
+}
+
+void VboSceneDrawer::Release(FigureBuffers& buffers) {
+  buffers.vao.destroy();
+  glDeleteBuffers(1, &buffers.positions);
+  glDeleteBuffers(1, &buffers.edges);
+}
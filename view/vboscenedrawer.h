@@ -0,0 +1,88 @@
+#ifndef SRC_3DVIEWER_VIEW_VBOSCENEDRAWER_H_
+#define SRC_3DVIEWER_VIEW_VBOSCENEDRAWER_H_
+
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <memory>
+#include <unordered_map>
+
+#include "qtscenedrawer.h"
+#include "scenedrawerbase.h"
+namespace viewer {
+// Отрисовка из буферов GL. Позиции фигуры лежат в вершинном буфере, рёбра
+// в индексном; они загружаются один раз, после изменения геометрии
+// дозагружаются только Figure::GetDirtyVertices / GetDirtyEdges, а кадр
+// стоит одного glDrawElements (рёбра) и одного glDrawArrays (точки) на
+// непрерывный участок видимых кластеров фигуры. Поза передаётся
+// uniform-матрицей и буферов не касается.
+// Ломаные Figure::BuildStrips здесь не нужны: при выводе по индексам
+// общие вершины и так не обрабатываются повторно, а GL_LINE_STRIP с
+// перезапуском на llvmpipe медленнее пар номеров.
+//
+// Шейдеры на GLSL 1.20 берут вид и проекцию из матриц фиксированного
+// конвейера, которые настраивает MyGLWidget, так что работают в профиле
+// совместимости любой реализации, включая программную Mesa llvmpipe.
+// Если шейдеры не собрались, рисует QTSceneDrawer.
+class VboSceneDrawer : public SceneDrawerBase, protected QOpenGLFunctions {
+  Q_OBJECT
+ public:
+  VboSceneDrawer() = default;
+  // Контекст GL, в котором рисовали, должен быть текущим.
+  ~VboSceneDrawer() override;
+  void DrawScene(const Scene& scene, const QColor& edgeColor) override;
+  void DrawPoints(const Scene& scene, const QColor& vertexColor) override;
+
+ private:
+  struct FigureBuffers {
+    std::weak_ptr<const Figure> figure;
+    uint64_t version = 0;
+    uint64_t frame = 0;
+    QOpenGLVertexArrayObject vao;
+    GLuint positions = 0;
+    GLuint edges = 0;
+    // размеры буферов GL в байтах
+    size_t positionCapacity = 0;
+    size_t edgeCapacity = 0;
+    GLenum positionType = GL_FLOAT;
+    GLenum indexType = GL_UNSIGNED_INT;
+    GLsizei vertexCount = 0;
+    GLsizei indexCount = 0;
+  };
+
+  bool Initialize();
+  // Буферы фигуры с её текущей геометрией: при первом обращении
+  // загружается всё, потом - изменённые диапазоны.
+  FigureBuffers& BuffersFor(const std::shared_ptr<Figure>& figure);
+  // Не даёт освободить буферы фигуры и её уровней детализации, которые
+  // в этом кадре не рисовались, чтобы смена уровня при масштабировании
+  // не загружала их заново.
+  void KeepLevels(const Figure& figure);
+  void Upload(const Figure& figure, FigureBuffers& buffers,
+              IndexRange vertices, IndexRange edges);
+  // Записывает байты [begin, end) из data; буфер, в который data не
+  // помещается, пересоздаётся с запасом и записывается целиком.
+  void WriteBuffer(GLenum target, GLuint buffer, size_t& capacity,
+                   std::span<const std::byte> data, size_t begin,
+                   size_t end);
+  void BindAttributes(FigureBuffers& buffers);
+  void Release(FigureBuffers& buffers);
+  // Вызывает draw(drawn, model, buffers) для каждой фигуры: drawn - она
+  // сама или её уровень детализации, model - её матрица модели.
+  template <typename F>
+  void DrawFigures(const Scene& scene, const View& view, const QColor& color,
+                   F draw);
+
+  bool initialized_ = false;
+  bool usable_ = false;
+  QOpenGLShaderProgram program_;
+  int positionLocation_ = -1;
+  int modelLocation_ = -1;
+  int colorLocation_ = -1;
+  std::unordered_map<const Figure*, std::unique_ptr<FigureBuffers>> buffers_;
+  uint64_t frame_ = 0;
+  QTSceneDrawer fallback_;
+};
+}  // namespace viewer
+
+#endif  // SRC_3DVIEWER_VIEW_VBOSCENEDRAWER_H_